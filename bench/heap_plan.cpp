@@ -0,0 +1,33 @@
+/* Prints the memory the web build is linked with for a match of the given
+   size and players: the heap plan of the match plus RUNTIME_HEAP_BYTES,
+   rounded up to whole 64KiB WebAssembly pages. The plan is made natively,
+   where pointers are wider than on the web, so it is an upper bound there.
+   The breakdown goes to stderr.
+
+   Usage: heap-plan size players */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "heapbudget.h"
+#include "mapgrid.h"
+
+const size_t WASM_PAGE_BYTES = 65536;
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "Usage: %s size players\n", argv[0]);
+    return 1;
+  }
+  MapGrid grid(nullptr, atoi(argv[1]), atoi(argv[2]), DEFAULT_GRID_LAYOUT, 1);
+  HeapBudget b = planHeap(grid);
+  size_t bytes = b.total() + RUNTIME_HEAP_BYTES;
+  bytes = (bytes + WASM_PAGE_BYTES - 1) / WASM_PAGE_BYTES * WASM_PAGE_BYTES;
+  fprintf(stderr, "grid %zu agents %zu events %zu objectives %zu dict %zu\n",
+          b.gridBytes, b.agentBytes, b.eventBytes, b.objectiveBytes,
+          b.dictBytes);
+  fprintf(stderr, "plan %zu runtime %zu pages %zu\n", b.total(),
+          RUNTIME_HEAP_BYTES, bytes / WASM_PAGE_BYTES);
+  printf("%zu\n", bytes);
+  return 0;
+}
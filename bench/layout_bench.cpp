@@ -0,0 +1,261 @@
+/* Benchmark of the MapGrid layouts on the access patterns the game uses:
+   the full scent sweep in Game::update, the five unit neighborhood read in
+   Agent::update and the square blast scan in Game::receiveBombEvent. It
+   times MapGrid::diffuse passing every player's plane at once, and then
+   checks that letting scent chunks sleep stays within SLEEP_TOLERANCE
+   of sweeping every chunk in each diffusion mode, printing how many chunks
+   sleep on each map size, and exits with 1 if not.
+
+   Usage: layout-bench [iterations] */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "constants.h"
+#include "mapgrid.h"
+#include "mapunit.h"
+
+typedef std::chrono::steady_clock benchclock;
+
+/* Letting chunks sleep only approximates sweeping every chunk: scent at or
+   below SCENT_EPSILON left in a chunk as it falls asleep is cleared rather
+   than diffused into its neighbors, and in red black mode that can tip the
+   rounding of the scent around it. No unit may differ from the full sweep by
+   more than this fraction of the scent held at the sources */
+const double SLEEP_SOURCE = 255.0;
+const double SLEEP_TOLERANCE = 1e-12;
+
+static const char *layoutNames[4] = {"row-major", "tiled-8", "tiled-16",
+                                     "morton"};
+
+/* Put some walls and scent on the map so the kernels have work to do */
+static void fillGrid(MapGrid &grid) {
+  ScentPlane &plane = grid.planes[SPAWNER_ID_ONE];
+  for (unsigned int y = 0; y < grid.size; y++) {
+    for (unsigned int x = 0; x < grid.size; x++) {
+      unsigned int i = grid.indexOf(x, y);
+      if (rand() % 10 == 0)
+        grid.types[i] = UNIT_TYPE_WALL;
+      plane.scent[i] = toScent(rand() % 256);
+    }
+  }
+}
+
+static double sweep(MapGrid &grid) {
+  ScentPlane &plane = grid.planes[SPAWNER_ID_ONE];
+  for (unsigned int y = 0; y < grid.size; y++) {
+    for (unsigned int x = 0; x < grid.size; x++) {
+      unsigned int i = grid.indexOf(x, y);
+      plane.prevScent[i] = plane.scent[i];
+      Scent coeff = (grid.types[i] == UNIT_TYPE_EMPTY) ? SCENT_COEFF : 0;
+      plane.scent[i] = diffuseScent(coeff,
+                                    plane.prevScent[grid.neighbor(i, -1, 0)],
+                                    plane.prevScent[grid.neighbor(i, 0, -1)],
+                                    plane.scent[grid.neighbor(i, 1, 0)],
+                                    plane.scent[grid.neighbor(i, 0, 1)]);
+    }
+  }
+  return fromScent(plane.scent[grid.indexOf(grid.size / 2, grid.size / 2)]);
+}
+
+static double neighborhoods(MapGrid &grid, std::vector<unsigned int> &agents) {
+  double total = 0.0;
+  for (unsigned int a : agents) {
+    MapUnit unit = grid.unitAt(a);
+    MapUnit neighbors[5] = {unit.left(), unit.right(), unit.up(), unit.down(),
+                            unit};
+    for (MapUnit &m : neighbors) {
+      if (m.type() == UNIT_TYPE_EMPTY)
+        total += fromScent(m.scent(SPAWNER_ID_ONE));
+    }
+  }
+  return total;
+}
+
+static double blasts(MapGrid &grid, std::vector<unsigned int> &centers) {
+  int count = 0;
+  for (unsigned int c : centers) {
+    int cx = grid.xOf(c);
+    int cy = grid.yOf(c);
+    int startx = (cx - BOMB_AOE_RADIUS < 0) ? 0 : cx - BOMB_AOE_RADIUS;
+    int starty = (cy - BOMB_AOE_RADIUS < 0) ? 0 : cy - BOMB_AOE_RADIUS;
+    int w = BOMB_AOE_RADIUS * 2;
+    int h = BOMB_AOE_RADIUS * 2;
+    if (startx + w > (int)grid.size)
+      w = grid.size - startx;
+    if (starty + h > (int)grid.size)
+      h = grid.size - starty;
+    MapUnit firstInRow = grid.unitAt(startx, starty);
+    for (int i = 0; i < h; i++) {
+      MapUnit m = firstInRow;
+      for (int j = 0; j < w; j++) {
+        int dx = startx + j - cx;
+        int dy = starty + i - cy;
+        if (dx * dx + dy * dy <= BOMB_AOE_RADIUS * BOMB_AOE_RADIUS &&
+            m.type() == UNIT_TYPE_EMPTY)
+          count++;
+        m = m.right();
+      }
+      firstInRow = firstInRow.down();
+    }
+  }
+  return count;
+}
+
+template <typename F> static double timeMs(F f, int iterations, double *sink) {
+  auto start = benchclock::now();
+  for (int i = 0; i < iterations; i++)
+    *sink += f();
+  std::chrono::duration<double, std::milli> elapsed = benchclock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+/* Keep every chunk of the plane awake for the next pass, as a full sweep
+   would */
+static void wakeAll(MapGrid &grid, SpawnerID sid) {
+  ScentPlane &plane = grid.planes[sid];
+  for (unsigned int c = 0; c < plane.chunkMax.size(); c++) {
+    if (!plane.chunkAwake[c] && plane.chunkMax[c] <= SCENT_EPSILON)
+      plane.touchedChunks.push_back(c);
+    if (plane.chunkMax[c] <= SCENT_EPSILON)
+      plane.chunkMax[c] = 1.0;
+  }
+}
+
+/* Milliseconds a pass of MapGrid::diffuse takes over every player's plane
+   on one thread, with all the chunks awake, on a map with walls and doors
+   of every player */
+static double fusedMs(int size, int players, int iterations) {
+  MapGrid grid(nullptr, size, players, GRID_LAYOUT_ROW_MAJOR, 1);
+  std::vector<SpawnerID> sids;
+  srand(1);
+  for (int i = 0; i < size * size / 10; i++)
+    grid.setType(grid.indexOf(rand() % size, rand() % size), UNIT_TYPE_WALL);
+  for (int i = 0; i < size * size / 100; i++) {
+    unsigned int d = grid.indexOf(rand() % size, rand() % size);
+    grid.doors[d] = {(SpawnerID)(rand() % players), MAX_DOOR_HEALTH, true};
+    grid.setType(d, UNIT_TYPE_DOOR);
+  }
+  for (int s = 0; s < players; s++) {
+    sids.push_back((SpawnerID)s);
+    for (int y = 0; y < size; y++) {
+      for (int x = 0; x < size; x++)
+        grid.planes[s].scent[grid.indexOf(x, y)] = toScent(rand() % 256);
+    }
+  }
+  double sink = 0.0;
+  return timeMs(
+      [&]() {
+        for (SpawnerID sid : sids)
+          wakeAll(grid, sid);
+        grid.diffuse(sids.data(), players);
+        return 0.0;
+      },
+      iterations, &sink);
+}
+
+/* Largest difference in scent between letting chunks sleep and sweeping
+   every chunk, as a fraction of SLEEP_SOURCE, after ticks passes of the mode
+   with a few sources held on a walled map. The sources are in the top left
+   quarter, so the far side of a map well past SCENT_REACH across falls
+   asleep; the share of chunks asleep at the end goes in asleepShare */
+static double sleepError(DiffusionMode mode, int size, int ticks,
+                         double *asleepShare) {
+  MapGrid asleep(nullptr, size, 2, GRID_LAYOUT_ROW_MAJOR, 1);
+  MapGrid awake(nullptr, size, 2, GRID_LAYOUT_ROW_MAJOR, 1);
+  std::vector<unsigned int> sources;
+  srand(1);
+  for (int i = 0; i < size * size / 10; i++) {
+    int x = rand() % size;
+    int y = rand() % size;
+    asleep.setType(asleep.indexOf(x, y), UNIT_TYPE_WALL);
+    awake.setType(awake.indexOf(x, y), UNIT_TYPE_WALL);
+  }
+  for (int i = 0; i < 4; i++)
+    sources.push_back(asleep.indexOf(rand() % (size / 4), rand() % (size / 4)));
+  double most = 0.0;
+  for (MapGrid *grid : {&asleep, &awake}) {
+    grid->setDiffusionMode(mode);
+    ScentPlane &plane = grid->planes[SPAWNER_ID_ONE];
+    for (int t = 0; t < ticks; t++) {
+      for (unsigned int i : sources) {
+        plane.scent[i] = toScent(SLEEP_SOURCE);
+        grid->touchScent(i, SPAWNER_ID_ONE, SLEEP_SOURCE);
+      }
+      if (grid == &awake)
+        wakeAll(*grid, SPAWNER_ID_ONE);
+      grid->diffuse(SPAWNER_ID_ONE);
+    }
+  }
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      unsigned int i = asleep.indexOf(x, y);
+      double d = fabs(fromScent(asleep.planes[SPAWNER_ID_ONE].scent[i]) -
+                      fromScent(awake.planes[SPAWNER_ID_ONE].scent[i]));
+      if (d > most)
+        most = d;
+    }
+  }
+  ScentPlane &plane = asleep.planes[SPAWNER_ID_ONE];
+  *asleepShare = 1.0 - (double)plane.awakeChunks.size() / plane.chunkMax.size();
+  return most / SLEEP_SOURCE;
+}
+
+int main(int argc, char *argv[]) {
+  int iterations = (argc > 1) ? atoi(argv[1]) : 20;
+  int sizes[2] = {200, 1000};
+  double sink = 0.0;
+  printf("%-6s %-10s %12s %16s %12s\n", "size", "layout", "sweep ms",
+         "neighborhood ms", "blast ms");
+  for (int size : sizes) {
+    for (int l = GRID_LAYOUT_ROW_MAJOR; l <= GRID_LAYOUT_MORTON; l++) {
+      srand(1);
+      MapGrid grid(nullptr, size, 2, (GridLayout)l);
+      fillGrid(grid);
+      /* One agent for every twenty units and a blast for every ten thousand,
+         at the same coordinates for every layout */
+      std::vector<unsigned int> agents, centers;
+      for (int i = 0; i < size * size / 20; i++)
+        agents.push_back(grid.indexOf(rand() % size, rand() % size));
+      for (int i = 0; i < size * size / 10000 + 1; i++)
+        centers.push_back(grid.indexOf(rand() % size, rand() % size));
+      double sweepMs = timeMs([&]() { return sweep(grid); }, iterations, &sink);
+      double neighborMs = timeMs(
+          [&]() { return neighborhoods(grid, agents); }, iterations, &sink);
+      double blastMs =
+          timeMs([&]() { return blasts(grid, centers); }, iterations, &sink);
+      printf("%-6d %-10s %12.3f %16.3f %12.3f\n", size, layoutNames[l],
+             sweepMs, neighborMs, blastMs);
+    }
+  }
+  printf("%-6s %-8s %12s\n", "size", "players", "diffuse ms");
+  for (int size : sizes) {
+    for (int players : {2, MAX_PLAYERS}) {
+      printf("%-6d %-8d %12.3f\n", size, players,
+             fusedMs(size, players, iterations));
+    }
+  }
+  const char *modeNames[3] = {"in-place", "jacobi", "red-black"};
+  bool ok = true;
+  /* The two map sizes the web client plays on, and one well past
+     SCENT_REACH */
+  for (int size : {100, 200, 512}) {
+    for (int mode = DIFFUSION_MODE_IN_PLACE; mode <= DIFFUSION_MODE_RED_BLACK;
+         mode++) {
+      double asleepShare;
+      double error = sleepError((DiffusionMode)mode, size, 320, &asleepShare);
+      printf("sleep error %-4d %-10s %g, tolerance %g, %.0f%% of chunks "
+             "asleep\n",
+             size, modeNames[mode], error, SLEEP_TOLERANCE,
+             100.0 * asleepShare);
+      ok = ok && error <= SLEEP_TOLERANCE;
+    }
+  }
+  /* Keep the kernels from being optimized away */
+  if (sink == -1.0)
+    printf("%f\n", sink);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+/* Checks MapFile::isValid on maps written to a temporary file: a good map
+   must pass, and each broken copy of it must fail - too big, a spawner off
+   the edge or so far out that a narrower sum would wrap, two players'
+   spawners overlapping, a door owned by a player not in the match, and a
+   file cut short. Exits with 1 if any answer is wrong.
+
+   Usage: map-test */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+
+#include "mapfile.h"
+
+const int TEST_SIZE = 40;
+const int TEST_PLAYERS = 2;
+
+struct TestMap {
+  MapFileHeader header;
+  std::vector<unsigned char> cells;
+  size_t cut;
+};
+
+static TestMap goodMap() {
+  TestMap m;
+  memset(&m.header, 0, sizeof(m.header));
+  memcpy(m.header.magic, MAP_FILE_MAGIC, sizeof(MAP_FILE_MAGIC));
+  m.header.version = MAP_FILE_VERSION;
+  m.header.size = TEST_SIZE;
+  m.header.numSpawners = TEST_PLAYERS;
+  m.header.spawners[0][0] = 2;
+  m.header.spawners[0][1] = 2;
+  m.header.spawners[1][0] = TEST_SIZE - SPAWNER_SIZE - 2;
+  m.header.spawners[1][1] = TEST_SIZE - SPAWNER_SIZE - 2;
+  m.cells.assign(TEST_SIZE * TEST_SIZE, MAP_CELL_EMPTY);
+  m.cells[TEST_SIZE / 2 * TEST_SIZE + TEST_SIZE / 2] = MAP_CELL_WALL;
+  m.cells[TEST_SIZE / 2 * TEST_SIZE + TEST_SIZE / 2 + 1] = MAP_CELL_DOOR + 1;
+  m.cut = 0;
+  return m;
+}
+
+/* Writes the map out, loads it back and asks whether two players can play
+   on it */
+static bool valid(const TestMap &m) {
+  char path[] = "/tmp/map-test-XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    perror("mkstemp");
+    exit(1);
+  }
+  size_t n = m.cells.size() - m.cut;
+  if (write(fd, &m.header, sizeof(m.header)) != (ssize_t)sizeof(m.header) ||
+      write(fd, m.cells.data(), n) != (ssize_t)n) {
+    perror("write");
+    exit(1);
+  }
+  close(fd);
+  MapFile file(path);
+  bool ok = file.isValid(TEST_PLAYERS);
+  unlink(path);
+  return ok;
+}
+
+static bool check(const char *name, const TestMap &m, bool want) {
+  bool got = valid(m);
+  printf("%-24s %-8s %s\n", name, got ? "valid" : "invalid",
+         got == want ? "ok" : "WRONG");
+  return got == want;
+}
+
+int main() {
+  bool ok = true;
+  TestMap m = goodMap();
+  ok &= check("good", m, true);
+
+  m = goodMap();
+  m.header.size = MAP_FILE_MAX_SIZE + 1;
+  m.cells.assign((size_t)m.header.size * m.header.size, MAP_CELL_EMPTY);
+  ok &= check("too big", m, false);
+
+  m = goodMap();
+  m.header.size = 0xffffffffu;
+  ok &= check("size near 2^32", m, false);
+
+  m = goodMap();
+  m.header.spawners[1][0] = TEST_SIZE - SPAWNER_SIZE + 1;
+  ok &= check("spawner off the edge", m, false);
+
+  m = goodMap();
+  m.header.spawners[1][1] = 0x7fffffff;
+  ok &= check("spawner far out", m, false);
+
+  m = goodMap();
+  m.header.spawners[1][1] = -1;
+  ok &= check("spawner negative", m, false);
+
+  m = goodMap();
+  m.header.spawners[1][0] = m.header.spawners[0][0] + SPAWNER_SIZE - 1;
+  m.header.spawners[1][1] = m.header.spawners[0][1] + SPAWNER_SIZE - 1;
+  ok &= check("spawners overlap", m, false);
+
+  m = goodMap();
+  m.header.spawners[1][0] = m.header.spawners[0][0] + SPAWNER_SIZE;
+  m.header.spawners[1][1] = m.header.spawners[0][1];
+  ok &= check("spawners touch", m, true);
+
+  m = goodMap();
+  m.cells[0] = MAP_CELL_DOOR + TEST_PLAYERS;
+  ok &= check("door of no player", m, false);
+
+  m = goodMap();
+  m.cut = 1;
+  ok &= check("cut short", m, false);
+
+  return ok ? 0 : 1;
+}
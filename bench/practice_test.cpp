@@ -0,0 +1,113 @@
+/* Checks the fused diffusion of practice mode against diffusing each player
+   on its own turn. Practice diffuses both planes in one pass before TWO's
+   turn and then patches ONE's plane with MapGrid::rediffuseChanges; the
+   reference diffuses ONE only after TWO's turn. During TWO's turn walls go
+   up and come down and a door opens, some before and some after the journal
+   is cleared as Game::receiveEventsBuffer does. ONE's scent must come out
+   the same in both after every tick, in each mode the fused pass is used
+   for. Exits with 1 if it does not.
+
+   Usage: practice-test */
+
+#include <cmath>
+#include <cstdio>
+
+#include "constants.h"
+#include "mapgrid.h"
+
+const int TEST_SIZE = 64;
+const int TEST_TICKS = 120;
+const double TEST_SOURCE = 255.0;
+
+/* Make the changes of TWO's turn on tick t, once ONE's scent has spread
+   over them. before is true for the changes made before the journal is
+   cleared, as the ones of Game::update are */
+static void turnOfTwo(MapGrid &grid, int t, bool before) {
+  if (before && t == 70) {
+    for (int x = 20; x < 30; x++)
+      grid.setType(grid.indexOf(x, 12), UNIT_TYPE_WALL);
+  }
+  /* A wall across the middle, with a gap at each end */
+  if (!before && t == 75) {
+    for (int x = 8; x < TEST_SIZE - 8; x++)
+      grid.setType(grid.indexOf(x, TEST_SIZE / 2), UNIT_TYPE_WALL);
+  }
+  if (before && t == 80) {
+    unsigned int i = grid.indexOf(TEST_SIZE / 2, TEST_SIZE / 2);
+    grid.doors[i] = {SPAWNER_ID_ONE, MAX_DOOR_HEALTH, true};
+    grid.setType(i, UNIT_TYPE_DOOR);
+  }
+  if (!before && t == 90) {
+    for (int x = 20; x < 25; x++)
+      grid.setType(grid.indexOf(x, 12), UNIT_TYPE_EMPTY);
+  }
+  if (!before && t == 100) {
+    unsigned int i = grid.indexOf(TEST_SIZE / 2, TEST_SIZE / 2);
+    grid.doors[i].isEmpty = false;
+    grid.refreshDoor(i);
+  }
+}
+
+/* Hold a source for each player in opposite corners */
+static void holdSources(MapGrid &grid) {
+  unsigned int one = grid.indexOf(4, TEST_SIZE - 5);
+  unsigned int two = grid.indexOf(TEST_SIZE - 5, 4);
+  grid.planes[SPAWNER_ID_ONE].scent[one] = toScent(TEST_SOURCE);
+  grid.touchScent(one, SPAWNER_ID_ONE, TEST_SOURCE);
+  grid.planes[SPAWNER_ID_TWO].scent[two] = toScent(TEST_SOURCE);
+  grid.touchScent(two, SPAWNER_ID_TWO, TEST_SOURCE);
+}
+
+/* Largest difference in ONE's scent between the two over the match, as a
+   fraction of TEST_SOURCE */
+static double fusedError(DiffusionMode mode, int threads) {
+  static const SpawnerID both[2] = {SPAWNER_ID_TWO, SPAWNER_ID_ONE};
+  MapGrid fused(nullptr, TEST_SIZE, 2, GRID_LAYOUT_ROW_MAJOR, threads);
+  MapGrid alone(nullptr, TEST_SIZE, 2, GRID_LAYOUT_ROW_MAJOR, threads);
+  fused.setDiffusionMode(mode);
+  alone.setDiffusionMode(mode);
+  double most = 0.0;
+  for (int t = 0; t < TEST_TICKS; t++) {
+    holdSources(fused);
+    fused.diffuse(both, 2);
+    turnOfTwo(fused, t, true);
+    fused.clearJournal();
+    turnOfTwo(fused, t, false);
+    fused.rediffuseChanges(SPAWNER_ID_ONE);
+
+    holdSources(alone);
+    alone.diffuse(SPAWNER_ID_TWO);
+    turnOfTwo(alone, t, true);
+    alone.clearJournal();
+    turnOfTwo(alone, t, false);
+    alone.diffuse(SPAWNER_ID_ONE);
+
+    for (int y = 0; y < TEST_SIZE; y++) {
+      for (int x = 0; x < TEST_SIZE; x++) {
+        unsigned int i = fused.indexOf(x, y);
+        double d = fabs(fromScent(fused.planes[SPAWNER_ID_ONE].scent[i]) -
+                        fromScent(alone.planes[SPAWNER_ID_ONE].scent[i]));
+        if (d > most)
+          most = d;
+      }
+    }
+  }
+  return most / TEST_SOURCE;
+}
+
+int main() {
+  bool ok = true;
+  struct {
+    const char *name;
+    DiffusionMode mode;
+    int threads;
+  } runs[3] = {{"in-place", DIFFUSION_MODE_IN_PLACE, 1},
+               {"in-place, 2 threads", DIFFUSION_MODE_IN_PLACE, 2},
+               {"jacobi", DIFFUSION_MODE_JACOBI, 1}};
+  for (auto &run : runs) {
+    double error = fusedError(run.mode, run.threads);
+    printf("%-20s %g %s\n", run.name, error, error == 0.0 ? "ok" : "WRONG");
+    ok = ok && error == 0.0;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+/* Checks that the coarse scent levels honour walls and give a heading where
+   the fine scent has died out. A source is held near the left edge of a map
+   well past SCENT_REACH across, and a unit near the right edge, out of the
+   fine scent's reach, asks MapGrid::coarseScents which way to go:
+     - on an open map it must be told to go left;
+     - with a wall from top to bottom loaded from the map it must get no
+       heading, and the levels must hold no scent past the wall;
+     - with a gap in that wall as wide as the coarsest cell, it must get one;
+     - with the wall put up after the scent has spread, the scent past it
+       must die out.
+   Exits with 1 if any answer is wrong.
+
+   Usage: pyramid-test */
+
+#include <cstdio>
+#include <vector>
+
+#include "constants.h"
+#include "mapfile.h"
+#include "mapgrid.h"
+
+const int TEST_SIZE = 512;
+const int TEST_WALL_X = TEST_SIZE / 2;
+const int TEST_TICKS = 100;
+/* Long enough for scent held past the wall to fall below SCENT_EPSILON */
+const int TEST_DIE_TICKS = 1000;
+
+enum TestWall { TEST_WALL_NONE, TEST_WALL_SOLID, TEST_WALL_GAP };
+
+/* The map, with a wall down column TEST_WALL_X if asked for, open for the
+   coarsest cell's width of rows in the middle for a gap */
+static std::vector<unsigned char> terrain(TestWall wall) {
+  std::vector<unsigned char> cells((size_t)TEST_SIZE * TEST_SIZE,
+                                   MAP_CELL_EMPTY);
+  if (wall == TEST_WALL_NONE)
+    return cells;
+  int gap = 1;
+  for (int l = 0; l < SCENT_PYRAMID_LEVELS; l++)
+    gap *= SCENT_PYRAMID_FACTOR;
+  for (int y = 0; y < TEST_SIZE; y++) {
+    if (wall == TEST_WALL_GAP && y >= TEST_SIZE / 2 &&
+        y < TEST_SIZE / 2 + gap)
+      continue;
+    cells[(size_t)y * TEST_SIZE + TEST_WALL_X] = MAP_CELL_WALL;
+  }
+  return cells;
+}
+
+static void tick(MapGrid &grid, int ticks) {
+  unsigned int source = grid.indexOf(8, TEST_SIZE / 2);
+  for (int t = 0; t < ticks; t++) {
+    grid.planes[SPAWNER_ID_ONE].scent[source] = toScent(255.0);
+    grid.touchScent(source, SPAWNER_ID_ONE, 255.0);
+    grid.diffuse(SPAWNER_ID_ONE);
+  }
+}
+
+/* Most scent on any level in the cells wholly right of the wall */
+static double pastWall(MapGrid &grid) {
+  double most = 0.0;
+  for (ScentLevel &level : grid.planes[SPAWNER_ID_ONE].levels) {
+    for (int y = 0; y < level.size; y++) {
+      for (int x = TEST_WALL_X / level.factor + 1; x < level.size; x++) {
+        double s = fromScent(level.scent[(y + 1) * level.stride + x + 1]);
+        if (s > most)
+          most = s;
+      }
+    }
+  }
+  return most;
+}
+
+static bool check(const char *name, bool got, bool want) {
+  printf("%-36s %-5s %s\n", name, got ? "yes" : "no",
+         got == want ? "ok" : "WRONG");
+  return got == want;
+}
+
+int main() {
+  bool ok = true;
+  unsigned int probe;
+  Scent around[4];
+  for (TestWall wall : {TEST_WALL_NONE, TEST_WALL_SOLID, TEST_WALL_GAP}) {
+    MapGrid grid(nullptr, TEST_SIZE, 1, GRID_LAYOUT_ROW_MAJOR, 1);
+    std::vector<unsigned char> cells = terrain(wall);
+    grid.loadTerrain(cells.data());
+    probe = grid.indexOf(TEST_SIZE - 24, TEST_SIZE / 2);
+    tick(grid, TEST_TICKS);
+    bool fine = fromScent(grid.planes[SPAWNER_ID_ONE].scent[probe]) > 0;
+    bool heading = grid.coarseScents(probe, SPAWNER_ID_ONE, around);
+    switch (wall) {
+    case TEST_WALL_NONE:
+      ok &= check("open: fine scent at the far unit", fine, false);
+      ok &= check("open: heading at the far unit", heading, true);
+      ok &= check("open: heading is left",
+                  heading && around[0] > around[1], true);
+      break;
+    case TEST_WALL_SOLID:
+      ok &= check("wall: heading at the far unit", heading, false);
+      ok &= check("wall: scent past the wall", pastWall(grid) > 0, false);
+      break;
+    case TEST_WALL_GAP:
+      ok &= check("gap: heading at the far unit", heading, true);
+      break;
+    }
+  }
+
+  MapGrid grid(nullptr, TEST_SIZE, 1, GRID_LAYOUT_ROW_MAJOR, 1);
+  tick(grid, TEST_TICKS);
+  ok &= check("late wall: scent past it before", pastWall(grid) > 0, true);
+  for (int y = 0; y < TEST_SIZE; y++)
+    grid.setType(grid.indexOf(TEST_WALL_X, y), UNIT_TYPE_WALL);
+  tick(grid, TEST_DIE_TICKS);
+  ok &= check("late wall: scent past it after", pastWall(grid) > 0, false);
+  ok &= check("late wall: heading at the far unit",
+              grid.coarseScents(probe, SPAWNER_ID_ONE, around), false);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+/* Checks that Game::reset leaves a played match the same as a freshly
+   constructed game, through what a player can see and do: the map, scent,
+   agents, buildings and objective tags read through Game::mapUnitAt, and
+   how the game answers the same input afterwards. The played game is left
+   zoomed in, panned, with a building being placed, so a view, selection or
+   placement left over from it would put the test's objective somewhere
+   else. Exits with 1 if the two differ.
+
+   It opens SDL windows and loads the font from assets/, so run it from the
+   top of the tree, with SDL_VIDEODRIVER=dummy where there is no display.
+   Nothing moves the mouse, so every click lands on the top left corner of
+   the game's view.
+
+   Usage: reset-test [ticks] */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "game.h"
+
+const int TEST_SIZE = 100;
+const int TEST_PANEL_SIZE = 200;
+const double TEST_SCALE = 4.0;
+const int TEST_SEED = 7;
+
+static unsigned long long h;
+
+static void mix(unsigned long long v) {
+  h ^= v;
+  h *= 1099511628211ull;
+}
+
+static unsigned long long hash(Game &g) {
+  h = 1469598103934665603ull;
+  mix(g.getContext());
+  mix(g.getPlayerSpawnID());
+  for (int y = 0; y < g.getSize(); y++) {
+    for (int x = 0; x < g.getSize(); x++) {
+      MapUnit u = g.mapUnitAt(x, y);
+      mix(u.type());
+      mix(u.hp());
+      mix(u.type() == UNIT_TYPE_AGENT ? u.agent()->getSpawnID() : 0);
+      if (u.type() == UNIT_TYPE_DOOR) {
+        mix(u.door().sid);
+        mix(u.door().hp);
+        mix(u.door().isEmpty);
+      }
+      for (int p = 0; p < (int)u.grid->planes.size(); p++) {
+        mix((unsigned long long)(fromScent(u.scent((SpawnerID)p)) * 1e6));
+        Objective *o = u.objective((SpawnerID)p);
+        mix(o ? o->type + 1 : 0);
+      }
+    }
+  }
+  return h;
+}
+
+static void push(SDL_Event &e) {
+  if (SDL_PushEvent(&e) < 0) {
+    printf("SDL_PushEvent: %s\n", SDL_GetError());
+    exit(1);
+  }
+}
+
+static void key(SDL_Keycode sym) {
+  SDL_Event e;
+  memset(&e, 0, sizeof(e));
+  e.type = SDL_KEYDOWN;
+  e.key.keysym.sym = sym;
+  push(e);
+}
+
+static void click() {
+  SDL_Event e;
+  memset(&e, 0, sizeof(e));
+  e.type = SDL_MOUSEBUTTONDOWN;
+  e.button.button = SDL_BUTTON_LEFT;
+  push(e);
+  e.type = SDL_MOUSEBUTTONUP;
+  push(e);
+}
+
+static void zoomIn() {
+  SDL_Event e;
+  memset(&e, 0, sizeof(e));
+  e.type = SDL_MOUSEWHEEL;
+  e.wheel.y = 1;
+  push(e);
+}
+
+/* Send agents to the unit in the corner of the view, then zoom in, pan
+   toward the middle and do the same again, then let the match run */
+static void play(Game &g, int ticks) {
+  click();
+  key(SDLK_g);
+  zoomIn();
+  zoomIn();
+  for (int i = 0; i < 3; i++) {
+    key(SDLK_RIGHT);
+    key(SDLK_DOWN);
+  }
+  click();
+  key(SDLK_g);
+  for (int t = 0; t < ticks; t++)
+    g.mainLoop();
+}
+
+int main(int argc, char *argv[]) {
+  int ticks = argc > 1 ? atoi(argv[1]) : 100;
+  bool ok = true;
+  /* Both practice modes: 1 attacks, 2 defends */
+  for (int mode = 1; mode <= 2; mode++) {
+    srand(1);
+    Game fresh(mode, TEST_SIZE, TEST_PANEL_SIZE, TEST_SCALE, nullptr, nullptr,
+               2, false);
+    unsigned long long want = hash(fresh);
+    srand(TEST_SEED);
+    play(fresh, ticks);
+    unsigned long long wantPlayed = hash(fresh);
+
+    srand(1);
+    Game played(mode, TEST_SIZE, TEST_PANEL_SIZE, TEST_SCALE, nullptr,
+                nullptr, 2, false);
+    srand(2);
+    play(played, ticks);
+    /* Leave it half way through placing a bomb */
+    key(SDLK_b);
+    played.mainLoop();
+    unsigned long long before = hash(played);
+    played.reset();
+    unsigned long long got = hash(played);
+    srand(TEST_SEED);
+    play(played, ticks);
+    unsigned long long gotPlayed = hash(played);
+    printf("mode %d fresh %016llx played %016llx reset %016llx\n", mode, want,
+           before, got);
+    printf("mode %d after the same input: fresh %016llx reset %016llx\n",
+           mode, wantPlayed, gotPlayed);
+    ok = ok && got == want && before != want && gotPlayed == wantPlayed;
+  }
+  return ok ? 0 : 1;
+}
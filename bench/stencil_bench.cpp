@@ -0,0 +1,115 @@
+/* Check and time the row stencils behind the scent diffusion. Every version
+   the CPU supports is run on the same random planes as the scalar reference
+   and must write the same bits and find the same most scent; then each one
+   is timed over a full plane, a whole row a call, and over the
+   SCENT_CHUNK_SIZE wide spans the game hands it, which is what the version
+   the game runs is picked by. Last, a source is held at full scent on an
+   open plane until its plume settles, which must reach SCENT_REACH units.
+
+   Usage: stencil-bench [size] [iterations] */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "scent.h"
+#include "stencil.h"
+
+typedef std::chrono::steady_clock benchclock;
+
+/* One pass of the stencil over a size by size plane with a one unit border,
+   returning the most scent written */
+static double pass(StencilRow row, std::vector<Scent> &out,
+                   const std::vector<Scent> &scent,
+                   const std::vector<Scent> &coeff, int size) {
+  int stride = size + 2;
+  double most = 0.0;
+  for (int j = 1; j <= size; j++) {
+    int start = j * stride + 1;
+    double rowMost =
+        row(out.data() + start, scent.data() + start - 1,
+            scent.data() + start - stride, scent.data() + start + 1,
+            scent.data() + start + stride, coeff.data() + start, size);
+    if (rowMost > most)
+      most = rowMost;
+  }
+  return most;
+}
+
+/* How many units from a source held at 255 scent the plume reaches once it
+   has settled, diffused with row */
+static int plumeReach(StencilRow row) {
+  int size = 2 * (SCENT_REACH + 50) + 1;
+  int stride = size + 2;
+  int center = (size / 2 + 1) * stride + size / 2 + 1;
+  std::vector<Scent> scent(stride * stride, 0), next(stride * stride, 0);
+  std::vector<Scent> coeff(stride * stride, SCENT_COEFF);
+  for (int t = 0; t < SCENT_REACH + 150; t++) {
+    scent[center] = toScent(255.0);
+    pass(row, next, scent, coeff, size);
+    scent.swap(next);
+  }
+  int reach = 0;
+  for (int k = 1; center + k < (size / 2 + 2) * stride - 1; k++) {
+    if (scent[center + k] > 0)
+      reach = k;
+  }
+  return reach;
+}
+
+int main(int argc, char *argv[]) {
+  int size = (argc > 1) ? atoi(argv[1]) : 1000;
+  int iterations = (argc > 2) ? atoi(argv[2]) : 50;
+  int units = (size + 2) * (size + 2);
+  std::vector<Scent> scent(units, 0), coeff(units, 0);
+  srand(1);
+  for (int j = 1; j <= size; j++) {
+    for (int k = 1; k <= size; k++) {
+      int i = j * (size + 2) + k;
+      scent[i] = toScent((double)rand() / RAND_MAX * 255.0);
+      /* Some scent near the flush threshold, to check it is applied alike */
+      if (rand() % 8 == 0)
+        scent[i] = toScent(fromScent(scent[i]) * fromScent(SCENT_FLUSH));
+      coeff[i] = (rand() % 10 == 0) ? 0 : SCENT_COEFF;
+    }
+  }
+  std::vector<Scent> reference(units, 0), out(units, 0);
+  double referenceMost =
+      pass(stencilRowFor(STENCIL_ISA_SCALAR), reference, scent, coeff, size);
+  bool ok = true;
+  double sink = 0.0;
+  printf("%-8s %10s %10s %8s\n", "isa", "pass ms", "spans us", "matches");
+  for (int isa = STENCIL_ISA_SCALAR; isa <= STENCIL_ISA_AVX512; isa++) {
+    if (!stencilSupported((StencilISA)isa)) {
+      printf("%-8s %10s %10s %8s\n", stencilISANames[isa], "-", "-", "-");
+      continue;
+    }
+    StencilRow row = stencilRowFor((StencilISA)isa);
+    std::fill(out.begin(), out.end(), 0);
+    double most = pass(row, out, scent, coeff, size);
+    bool matches = most == referenceMost &&
+                   memcmp(out.data(), reference.data(),
+                          units * sizeof(Scent)) == 0;
+    ok = ok && matches;
+    auto start = benchclock::now();
+    for (int i = 0; i < iterations; i++)
+      sink += pass(row, out, scent, coeff, size);
+    std::chrono::duration<double, std::milli> elapsed =
+        benchclock::now() - start;
+    printf("%-8s %10.3f %10.3f %8s\n", stencilISANames[isa],
+           elapsed.count() / iterations, stencilSpanTime(row),
+           matches ? "yes" : "NO");
+  }
+  printf("dispatched: %s, fastest on %d spans of %d\n",
+         stencilISANames[bestStencilISA()], STENCIL_TIMING_SPANS,
+         SCENT_CHUNK_SIZE);
+  int reach = plumeReach(stencilRowFor(bestStencilISA()));
+  printf("plume reach: %d units, need %d\n", reach, SCENT_REACH);
+  ok = ok && reach >= SCENT_REACH;
+  /* Keep the passes from being optimized away */
+  if (sink == -1.0)
+    printf("%f\n", sink);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+"""Write a binary map file (see include/mapfile.h) with random wall segments,
+some of them with neutral doors, for benchmarking and playing large,
+wall-heavy layouts.
+
+usage: python3 genmap.py <size> <output> [numWalls] [seed]
+
+Play on it with --map=<output> after the other arguments of plurabus-bin, or
+on the web by putting it in web/static/maps/ and adding ?map=<name> to the
+address of the game page.
+
+There is no automated test of the web side; to check it by hand, serve the
+web build with server.py and
+  - open a practice game with ?map=<name> for a map in web/static/maps/: the
+    game takes that map's size and terrain. With a name that isn't there,
+    the browser console says "Could not fetch map <name>" and the game
+    plays on the default terrain;
+  - start an online match with one player on ?map=<name> and the other
+    without it: the server logs "Players have different maps" and both
+    games end with "The players have different maps." instead of starting.
+"""
+import random
+import struct
+import sys
+
+MAGIC = b"PMAP"
+VERSION = 1
+MAX_PLAYERS = 8
+SPAWNER_SIZE = 8
+SPAWNER_PADDING = 10
+
+MAP_CELL_EMPTY = 0
+MAP_CELL_WALL = 1
+MAP_CELL_DOOR = 2
+
+def spawner_positions(size):
+    p1 = size - SPAWNER_PADDING - SPAWNER_SIZE
+    p2 = SPAWNER_PADDING
+    mid = (size - SPAWNER_SIZE) // 2
+    return [(p1, p1), (p2, p2), (p1, p2), (p2, p1),
+            (mid, p2), (mid, p1), (p2, mid), (p1, mid)]
+
+def generate(size, num_walls, seed):
+    rng = random.Random(seed)
+    cells = bytearray(size * size)
+    for _ in range(num_walls):
+        length = rng.randint(size // 20 + 1, size // 4 + 1)
+        x, y = rng.randrange(size), rng.randrange(size)
+        horizontal = rng.random() < 0.5
+        door_at = rng.randrange(length) if rng.random() < 0.3 else -1
+        for k in range(length):
+            cx, cy = (x + k, y) if horizontal else (x, y + k)
+            if cx >= size or cy >= size:
+                break
+            cells[cy * size + cx] = MAP_CELL_WALL
+            if k == door_at:
+                cells[cy * size + cx] = MAP_CELL_DOOR + rng.randrange(2)
+    # Keep the spawners and a margin around them clear
+    spawners = spawner_positions(size)
+    margin = 4
+    for sx, sy in spawners:
+        for y in range(max(0, sy - margin), min(size, sy + SPAWNER_SIZE + margin)):
+            for x in range(max(0, sx - margin), min(size, sx + SPAWNER_SIZE + margin)):
+                cells[y * size + x] = MAP_CELL_EMPTY
+    return cells, spawners
+
+def main():
+    if len(sys.argv) < 3:
+        print(__doc__)
+        sys.exit(1)
+    size = int(sys.argv[1])
+    num_walls = int(sys.argv[3]) if len(sys.argv) > 3 else size // 2
+    seed = int(sys.argv[4]) if len(sys.argv) > 4 else 0
+    cells, spawners = generate(size, num_walls, seed)
+    header = MAGIC + struct.pack("<III", VERSION, size, MAX_PLAYERS)
+    for sx, sy in spawners:
+        header += struct.pack("<ii", sx, sy)
+    with open(sys.argv[2], "wb") as f:
+        f.write(header)
+        f.write(cells)
+
+if __name__ == "__main__":
+    main()
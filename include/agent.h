@@ -1,11 +1,14 @@
 #ifndef AGENT_H
 #define AGENT_H
 
+#include <stddef.h>
+
 #include "event.h"
+#include "mapunit.h"
+#include "pool.h"
 
 /* Forward Declarations */
 class Game;
-struct MapUnit;
 
 class Agent {
   friend class Spawner;
@@ -16,12 +19,16 @@ class Agent {
 private:
   AgentID id;
   SpawnerID sid;
-  bool canMoveTo(MapUnit*);
+  bool canMoveTo(MapUnit);
   void die();
 public:
   Game* game;
-  MapUnit* unit;
-  Agent(Game*, MapUnit*, AgentID, SpawnerID);
+  MapUnit unit;
+  /* Agents are allocated from pool, which Game reserves for the map size */
+  static Pool<Agent> pool;
+  static void *operator new(size_t) {return pool.allocate();};
+  static void operator delete(void *p) {pool.release(p);};
+  Agent(Game*, MapUnit, AgentID, SpawnerID);
   ~Agent();
   void update(AgentEvent*);
   SpawnerID getSpawnID();
@@ -31,9 +31,9 @@ protected:
   int max_hp;
   int updateCounter;
   int updateTime;
-  MapUnit *center;
+  MapUnit center;
 public:
-  MapUnit::iterator getIterator();
+  RectView getView();
   bool canUpdate();
   Building(Game*, BuildingType, SpawnerID, int, int, int, int, int, int);
 };
@@ -6,6 +6,7 @@ const int STARTUP_TIME_SECONDS = 3;
 const int MENU_ITEMS_IN_VIEW = 6;
 const int SPAWNER_SIZE = 8;
 const int SPAWNER_PADDING = 10;
+const int MAX_PLAYERS = 8;
 const int SPAWNER_UPDATE_TIME = 1;
 const int STARTUP_FONT_SIZE = 32;
 const int FONT_SIZE = 16;
@@ -30,11 +31,26 @@ const int ZAP_CLEAR_TIME = 100;
 const int ZAP_EFFECTS_SUBDIVISION = 50;
 const int ZAP_CENTER_EFFECTS_NUM = 7;
 const int INIT_EVENT_BUFFER_SIZE = 16;
+const int OBJECTIVES_PER_PLAYER = 64;
+/* Most agents a player can have; their spawners wait while they have this
+   many. The agent pools are planned for it */
+const int MAX_AGENTS_PER_PLAYER = 2048;
 const int MAX_BOMBS = 1;
 const int MAX_BOMB_HEALTH = 300;
 const int BOMB_AOE_RADIUS = 20;
 const int BOMB_SIZE = 5;
 const int BOMB_CLEAR_TIME = 500;
+const int SCENT_CHUNK_SIZE = 16;
+/* Scent at or below this counts as none: double scent is flushed to zero
+   there, and chunks holding no more sleep. Scent falls to it some 230 units
+   from a source, so on the 100 and 200 maps next to no chunk sleeps (see
+   layout-bench); chunks only start to sleep on bigger maps. Practice
+   matches end on the same tick as with no cutoff on the 100 map, and about
+   1% later on the 200 map. A cutoff high enough to let chunks on the 200
+   map sleep cuts scent short of agents that would have followed it */
+const double SCENT_EPSILON = 1e-150;
+const double SCENT_DIFFUSION = 0.15;
+const int SCENT_PYRAMID_FACTOR = 4;
 extern const char *TITLE;
 
 #endif
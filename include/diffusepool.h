@@ -0,0 +1,37 @@
+#ifndef DIFFUSEPOOL_H
+#define DIFFUSEPOOL_H
+
+#include <pthread.h>
+
+#include <vector>
+
+class MapGrid;
+
+/* Worker threads that diffuse the scent planes of a pass together. The chunk
+   rows of the map are cut into one contiguous band per thread, the calling
+   thread taking the first, and each thread does its band of every plane; run
+   returns once every band is done. A Jacobi pass reads only
+   the previous plane and a red black half sweep only the other color, so the
+   bands need no locking and the result is the same for any number of
+   threads */
+class DiffusePool {
+public:
+  MapGrid *grid;
+  int numThreads;
+  std::vector<pthread_t> workers;
+  /* Two barriers a pass: the first hands out the work, the second waits
+     for every band */
+  pthread_barrier_t start;
+  pthread_barrier_t done;
+  /* The color of a red black half sweep, or -1 for the other modes */
+  int phase;
+  bool quit;
+  DiffusePool(MapGrid*, int);
+  DiffusePool(const DiffusePool&) = delete;
+  DiffusePool &operator=(const DiffusePool&) = delete;
+  ~DiffusePool();
+  void run(int = -1);
+  void band(int);
+};
+
+#endif
@@ -9,7 +9,11 @@ typedef enum _SpawnerID {
   SPAWNER_ID_ONE,
   SPAWNER_ID_TWO,
   SPAWNER_ID_THREE,
-  SPAWNER_ID_FOUR
+  SPAWNER_ID_FOUR,
+  SPAWNER_ID_FIVE,
+  SPAWNER_ID_SIX,
+  SPAWNER_ID_SEVEN,
+  SPAWNER_ID_EIGHT
 } SpawnerID;
 
 typedef enum AgentAction {
@@ -18,6 +18,7 @@
 #include "agent.h"
 #include "building.h"
 #include "event.h"
+#include "mapgrid.h"
 #include "mapunit.h"
 #include "menu.h"
 #include "objective.h"
@@ -27,6 +28,7 @@ class Display;
 class Spawner;
 class NetHandler;
 class Panel;
+class MapFile;
 
 /* Various game contexts */
 enum Context {
@@ -56,6 +58,7 @@ typedef enum DoneStatus {
   DONE_STATUS_BACKGROUND,
   DONE_STATUS_TIMEOUT,
   DONE_STATUS_FRAME_TIMEOUT,
+  DONE_STATUS_MAP_MISMATCH,
   DONE_STATUS_OTHER
 } DoneStatus;
 
@@ -78,6 +81,11 @@ typedef struct Colors {
   int r, g, b;
 } Colors;
 
+/* Agents by id, in id order. The tree nodes come from a pool sized when the
+   match starts */
+typedef std::map<AgentID, Agent*, std::less<AgentID>,
+                 NodeAllocator<std::pair<const AgentID, Agent*>>> AgentDict;
+
 class Game {
   friend class NetHandler;
   friend class Agent;
@@ -93,9 +101,11 @@ private:
   JavaVM *jvm;
 #endif
   NetHandler *net;
+  MapFile *mapFile;
   Menu *menu;
   Panel *panel;
   char *pairString;
+  char *serverURI;
   void *eventsBuffer;
   bool mobile;
   bool flipped_X;
@@ -105,7 +115,7 @@ private:
   unsigned int eventsBufferCapacity;
   Context context;
   SelectionContext selectionContext;
-  Colors colorScheme[4];
+  std::vector<Colors> colorScheme;
   double initScale;
   double scale;
   int turnNum;
@@ -123,26 +133,25 @@ private:
   int secondsRemaining;
   SDL_Rect selection;
   SDL_Rect view;
-  SDL_Texture* bombTextures[4];
+  std::vector<SDL_Texture*> bombTextures;
   std::map<ObjectiveType, SDL_Texture*> objectiveInfoTextures;
-  std::vector<MapUnit*> mapUnits;
+  MapGrid grid;
   std::deque<MarkedCoord> markedCoords;
   std::deque<AgentID> markedAgents;
   std::deque<Building *> markedBuildings;
   std::deque<TowerZap> towerZaps;
   std::deque<BombEffect> bombEffects;
   std::list<Objective*> objectives;
-  std::map<AgentID, Agent*> agentDict;
-  std::map<SpawnerID, int> numPlayerAgents;
+  NodePool agentNodes;
+  AgentDict agentDict;
+  std::vector<int> numPlayerAgents;
   std::map<BuildingType, std::deque<Building*>> buildingLists;
-  std::map<SpawnerID, int> turnMap;
   SpawnerID playerSpawnID;
   SpawnerID winnerSpawnID;
   DoneStatus doneStatus;
   AgentID newAgentID;
   BuildingType placingType;
-  MapUnit outside;
-  MapUnit* selectedUnit;
+  MapUnit selectedUnit;
   Objective *selectedObjective;
   pthread_mutex_t threadLock;
   bool rectCollides(SDL_Rect, SDL_Rect);
@@ -165,7 +174,7 @@ private:
   void deselect();
   int getTeamNum(SpawnerID);
   int scaleInt(int);
-  MapUnit::iterator getSelectionIterator();
+  RectView getSelectionView();
   void attack();
   void buildWall();
   void buildDoor();
@@ -201,12 +210,14 @@ private:
   void deleteMarkedAgents();
   void deleteMarkedBuildings();
   void checkSpawnersDestroyed();
-  void update();
+  void update(bool = true);
   void simpleAggMode();
   void simpleDefMode();
+  void placeSpawners();
+  void startMode();
 public:
   Display* disp;
-  MapUnit* mapUnitAt(int, int);
+  MapUnit mapUnitAt(int, int);
   Context getContext();
   unsigned long long getTime();
   AgentID getNewAgentID();
@@ -226,8 +237,9 @@ public:
   void zoomIn();
   void zoomOut();
   void end(DoneStatus);
+  void reset();
   static int messageSize(int);
-  Game(int, int, int, double, char*, char*, int, bool);
+  Game(int, int, int, double, char*, char*, int, bool, MapFile* = nullptr);
   ~Game();
   void mainLoop();
 };
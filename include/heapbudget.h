@@ -0,0 +1,45 @@
+#ifndef HEAPBUDGET_H
+#define HEAPBUDGET_H
+
+#include <stddef.h>
+
+class MapGrid;
+
+/* Memory a match is expected to need once it is under way, planned at
+   startup so the heap rarely has to grow during play. Growing the shared
+   memory of the web build stalls the main thread.
+   The grid and its scent planes are sized when the grid is made. Agents,
+   their events and their nodes in Game::agentDict are planned for
+   MAX_AGENTS_PER_PLAYER agents a player, or the map area if that is less,
+   which spawners never go past. Objectives are planned for
+   OBJECTIVES_PER_PLAYER a player but aren't capped; any past the plan spill
+   over to the heap, so the plan is where memory starts, not a limit */
+struct HeapBudget {
+  size_t agentCap;
+  /* Agent events one player sends a tick */
+  size_t eventCap;
+  size_t objectiveCap;
+  /* Upper bound on the size of an agentDict node */
+  size_t nodeBytes;
+  size_t gridBytes;
+  size_t agentBytes;
+  size_t eventBytes;
+  size_t objectiveBytes;
+  size_t dictBytes;
+  size_t total();
+};
+
+/* Upper bound on sizeof(Objective), so the plan can be made without the SDL
+   headers objective.h needs. Checked in objective.cpp */
+const size_t OBJECTIVE_BYTES = 64;
+
+/* What the web build needs besides the plan: the runtime, thread stacks,
+   the embedded assets and SDL's fonts and textures. This is the 64MB the
+   web build started with before there was a plan, which already held all of
+   that. The build is linked with this much more than the plan for the
+   largest web match (see web.mk) and can still grow past it */
+const size_t RUNTIME_HEAP_BYTES = 64 << 20;
+
+HeapBudget planHeap(MapGrid&);
+
+#endif
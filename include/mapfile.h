@@ -0,0 +1,56 @@
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "constants.h"
+
+/* Binary map file: a MapFileHeader followed by size * size terrain bytes in
+   row major order, one MapCell per unit. All fields are little endian; the
+   file is mapped read-only and handed to MapGrid::loadTerrain as is */
+
+const char MAP_FILE_MAGIC[4] = {'P', 'M', 'A', 'P'};
+const uint32_t MAP_FILE_VERSION = 1;
+
+/* Largest map a file may describe. An eight player match on it still fits
+   in the web build's MAXIMUM_MEMORY (see heap-plan) */
+const int MAP_FILE_MAX_SIZE = 1024;
+
+/* Command line argument naming the map file to play on, as in
+   --map=maps/arena.pmap */
+const char MAP_ARGUMENT[] = "--map=";
+
+/* A door cell is MAP_CELL_DOOR plus the SpawnerID of its owner, which must
+   be one of the players */
+typedef enum MapCell {
+  MAP_CELL_EMPTY,
+  MAP_CELL_WALL,
+  MAP_CELL_DOOR
+} MapCell;
+
+struct MapFileHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t size;
+  /* Top left corners of the spawners, one for each player at least; each
+     spawner must lie wholly on the map, and those the players start at must
+     not overlap */
+  uint32_t numSpawners;
+  int32_t spawners[MAX_PLAYERS][2];
+};
+
+class MapFile {
+private:
+  void *data;
+  size_t length;
+public:
+  MapFileHeader *header;
+  const unsigned char *cells;
+  MapFile(const char*);
+  ~MapFile();
+  bool isValid(int);
+  uint64_t hash();
+};
+
+#endif
@@ -0,0 +1,458 @@
+#ifndef MAPGRID_H
+#define MAPGRID_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "event.h"
+#include "scent.h"
+#include "stencil.h"
+
+typedef enum UnitType {
+  UNIT_TYPE_EMPTY,
+  UNIT_TYPE_BUILDING,
+  UNIT_TYPE_AGENT,
+  UNIT_TYPE_SPAWNER,
+  UNIT_TYPE_WALL,
+  UNIT_TYPE_DOOR,
+  UNIT_TYPE_OUTSIDE
+} UnitType;
+
+class Agent;
+class Building;
+class Game;
+struct MapUnit;
+struct Objective;
+
+struct Door {
+  SpawnerID sid;
+  int hp;
+  bool isEmpty;
+};
+
+/* How units are ordered in the grid arrays. Row major keeps each row
+   contiguous; the tiled layouts store 8x8 or 16x16 blocks contiguously and
+   Morton order interleaves the bits of x and y, so that units that are close
+   in 2-D are also close in memory */
+typedef enum GridLayout {
+  GRID_LAYOUT_ROW_MAJOR,
+  GRID_LAYOUT_TILED_8,
+  GRID_LAYOUT_TILED_16,
+  GRID_LAYOUT_MORTON
+} GridLayout;
+
+#ifndef DEFAULT_GRID_LAYOUT
+#define DEFAULT_GRID_LAYOUT GRID_LAYOUT_ROW_MAJOR
+#endif
+
+/* How a scent plane is diffused. In place keeps a single plane and saves
+   each unit to prevScent just before overwriting it, so the pass must go in
+   index order. Jacobi reads only scent, the previous tick's plane, and
+   writes the next plane into prevScent; the two are swapped after the pass,
+   so units can be updated in any order. Red black runs several over-relaxed
+   Gauss-Seidel sweeps a tick, each updating the units with x + y even and
+   then those with x + y odd in place; each half only reads units of the
+   other color, so it can go in any order. The scent put by objectives is
+   held through the sweeps, so the gradient around them settles in a few
+   ticks rather than many */
+typedef enum DiffusionMode {
+  DIFFUSION_MODE_IN_PLACE,
+  DIFFUSION_MODE_JACOBI,
+  DIFFUSION_MODE_RED_BLACK
+} DiffusionMode;
+
+#ifndef DEFAULT_DIFFUSION_MODE
+#define DEFAULT_DIFFUSION_MODE DIFFUSION_MODE_IN_PLACE
+#endif
+
+/* The relaxation factor and sweeps a tick of red black mode. Factors above 1
+   over-relax; past about 1.2 the sweeps start to overshoot */
+#ifndef DEFAULT_RELAXATION
+#define DEFAULT_RELAXATION 1.1
+#endif
+
+#ifndef DEFAULT_RELAXATION_SWEEPS
+#define DEFAULT_RELAXATION_SWEEPS 4
+#endif
+
+/* Threads that diffuse each plane; 0 takes one per hardware thread. The web
+   build keeps diffusion on the main thread. With more than one thread an in
+   place pass runs as Jacobi, since an in place band would read rows the band
+   above is still overwriting; both modes give the same scent */
+#ifndef DEFAULT_DIFFUSION_THREADS
+#ifdef __EMSCRIPTEN__
+#define DEFAULT_DIFFUSION_THREADS 1
+#else
+#define DEFAULT_DIFFUSION_THREADS 0
+#endif
+#endif
+
+/* Coarse levels of scent kept above each plane, each SCENT_PYRAMID_FACTOR
+   times coarser than the one below; 0 leaves only the fine plane */
+#ifndef SCENT_PYRAMID_LEVELS
+#define SCENT_PYRAMID_LEVELS 2
+#endif
+
+/* One bit per unit, packed 64 to a word and indexed by MapUnit::index */
+struct BitPlane {
+  std::vector<uint64_t> words;
+  BitPlane(unsigned int n): words((n + 63) / 64, 0) {};
+  bool test(unsigned int i) const {return (words[i >> 6] >> (i & 63)) & 1;};
+  void set(unsigned int i) {words[i >> 6] |= (uint64_t)1 << (i & 63);};
+  void clear(unsigned int i) {words[i >> 6] &= ~((uint64_t)1 << (i & 63));};
+  /* The bits of units i .. i + 63 in the low to high bits, with zeros past
+     the last word */
+  uint64_t run(unsigned int i) const {
+    unsigned int w = i >> 6;
+    uint64_t bits = words[w] >> (i & 63);
+    if ((i & 63) && w + 1 < words.size())
+      bits |= words[w + 1] << (64 - (i & 63));
+    return bits;
+  };
+};
+
+/* Two dimensional Fenwick tree over map coordinates; counts the units of one
+   type in any rectangle in O(log^2 size) */
+struct RectCounter {
+  int size;
+  std::vector<int> tree;
+  RectCounter(int, bool);
+  void reset(bool);
+  void build();
+  void add(int, int, int);
+  int prefix(int, int);
+  int count(int, int, int, int);
+};
+
+/* One coarse level of a player's scent. Each cell stands for a factor by
+   factor block of units and takes the most scent put on any of them; the
+   level diffuses like the fine plane, so scent crosses factor units a tick.
+   The cells sit row major inside a one cell border of zero coefficient.
+   A cell only passes scent on while none of its units keeps the player's
+   scent out, agents aside, so scent on the level never crosses a wall,
+   building or closed door it couldn't cross on the fine plane; it can miss
+   a way through narrower than a cell */
+struct ScentLevel {
+  int factor;
+  int size;
+  int stride;
+  /* The most scent on the level, 0 once it has died out */
+  double most;
+  std::vector<Scent> scent;
+  std::vector<Scent> next;
+  std::vector<Scent> coeff;
+  /* How many units of each cell keep scent out */
+  std::vector<int> blocked;
+  ScentLevel(int, int);
+  void reset();
+  int cellOf(int x, int y) {
+    return (y / factor + 1) * stride + x / factor + 1;
+  };
+  void touch(int, int, double);
+  void block(int, int, int);
+  void diffuse(StencilRow);
+};
+
+/* Dense per-player data for every unit; each array is indexed by
+   MapUnit::index. An objective tag only counts while its stamp in
+   objectiveEpochs equals epoch, so all the tags are cleared at once by
+   advancing epoch.
+   The map is also split into SCENT_CHUNK_SIZE square chunks; chunkMax holds
+   the most scent in each chunk. Chunks with no more than SCENT_EPSILON
+   scent in or next to them, and no agents, objectives or changes on them,
+   sleep through diffusion, which only approximates diffusing them (see
+   MapGrid::wakeChunks). A plane stops diffusing once its player is out of
+   the match */
+struct ScentPlane {
+  bool alive;
+  unsigned int epoch;
+  std::vector<Objective*> objectives;
+  std::vector<unsigned int> objectiveEpochs;
+  std::vector<Scent> scent;
+  std::vector<Scent> prevScent;
+  /* In scent units whatever the precision (see scent.h) */
+  std::vector<double> chunkMax;
+  /* The chunks awake for the last pass, as flags and in index order */
+  std::vector<unsigned char> chunkAwake;
+  std::vector<unsigned int> awakeChunks;
+  /* Sleeping chunks touchScent has woken since */
+  std::vector<unsigned int> touchedChunks;
+  /* Chunks MapGrid::keepAwake marked since the last pass, as flags and as a
+     list */
+  std::vector<unsigned char> chunkActive;
+  std::vector<unsigned int> activeChunks;
+  /* Units touchScent put scent on since the last pass, held fixed through
+     the sweeps of red black mode */
+  BitPlane sources;
+  std::vector<unsigned int> sourceList;
+  /* Units changed since the plane's last pass began, for
+     MapGrid::rediffuseChanges; changed marks the units in the list */
+  BitPlane changed;
+  std::vector<unsigned int> changedList;
+  /* Scratch space for MapGrid::diffuse and rediffuseChanges; nextAwake is
+     kept all clear */
+  std::vector<unsigned int> hotChunks;
+  std::vector<unsigned char> nextAwake;
+  std::vector<unsigned int> nextAwakeChunks;
+  /* The scent pyramid, finest level first, and the units counted as
+     keeping scent out of their cells there */
+  std::vector<ScentLevel> levels;
+  BitPlane levelBlocked;
+  ScentPlane(unsigned int, unsigned int);
+  void reset();
+  void clearChanged();
+};
+
+/* A unit that changed since the journal was last cleared, and the type it
+   had before its first change */
+struct CellChange {
+  unsigned int index;
+  UnitType from;
+};
+
+class MapGrid;
+class DiffusePool;
+
+/* Structure-of-arrays storage for every unit on the map. Each array is indexed
+   by MapUnit::index, which indexOf computes according to the layout. The map
+   is surrounded by a one unit border of OUTSIDE units, so the padded map is
+   stride = size + 2 units wide; in row major layout every unit on the map
+   reaches its neighbors at index +/- 1 and index +/- stride */
+class MapGrid {
+public:
+  Game *game;
+  GridLayout layout;
+  unsigned int size;
+  unsigned int stride;
+  unsigned int tileShift;
+  unsigned int tilesPerRow;
+  unsigned int numUnits;
+  unsigned int chunksPerRow;
+  std::vector<UnitType> types;
+  std::vector<int> hps;
+  std::vector<Agent*> agents;
+  std::vector<Building*> buildings;
+  std::vector<Door> doors;
+  /* A unit is marked this tick when its stamp equals markEpoch */
+  unsigned int markEpoch;
+  std::vector<unsigned int> marks;
+  /* One scent plane per SpawnerID in the match */
+  std::vector<ScentPlane> planes;
+  /* Occupancy bits for each UnitType, kept in step with types by setType */
+  std::vector<BitPlane> occupancy;
+  /* Rectangle counts for each UnitType on the map, also kept by setType */
+  std::vector<RectCounter> counters;
+  /* Per SpawnerID, the doors that player's agents can currently walk
+     through: full health and nobody standing in them */
+  std::vector<BitPlane> openDoors;
+  /* SCENT_COEFF on EMPTY units and 0 on the rest, kept by setType. Diffusion
+     reads its coefficients from here for every player, with only that
+     player's open doors patched in */
+  std::vector<Scent> diffusion;
+  /* Each unit that changed type, health, door state or occupant this tick,
+     once; journaled marks the units already in it */
+  std::vector<CellChange> journal;
+  BitPlane journaled;
+  DiffusionMode diffusionMode;
+  double relaxation;
+  int relaxationSweeps;
+  /* Row major grids run in place and Jacobi passes a row span at a time
+     through this row stencil, the widest this CPU supports; the other
+     layouts and red black mode update one unit at a time */
+  StencilRow stencilRow;
+  /* Shares out the chunk rows of each pass when there is more than one
+     thread, or nullptr */
+  DiffusePool *diffusePool;
+  /* The live planes of the pass under way */
+  std::vector<SpawnerID> passPlanes;
+  MapGrid(Game*, int, int, GridLayout = DEFAULT_GRID_LAYOUT,
+          int = DEFAULT_DIFFUSION_THREADS);
+  /* The grid owns diffusePool, whose threads point back at it */
+  MapGrid(const MapGrid&) = delete;
+  MapGrid &operator=(const MapGrid&) = delete;
+  ~MapGrid();
+  void reset();
+  size_t heapBytes();
+  unsigned int chunkOf(unsigned int);
+  void touchScent(unsigned int, SpawnerID, double);
+  void keepAwake(unsigned int, SpawnerID);
+  void keepAwake(int, int, int, int, SpawnerID);
+  bool coarseScents(unsigned int, SpawnerID, Scent*);
+  void refreshLevels(unsigned int, SpawnerID);
+  void refreshLevels(SpawnerID);
+  void updateUnit(unsigned int, SpawnerID, Scent);
+  void jacobiUnit(unsigned int, SpawnerID, Scent);
+  void relaxUnit(unsigned int, SpawnerID, Scent);
+  void setDiffusionMode(DiffusionMode);
+  void setRelaxation(double, int);
+  bool jacobiPass() {
+    return diffusionMode == DIFFUSION_MODE_JACOBI ||
+           (diffusionMode == DIFFUSION_MODE_IN_PLACE && diffusePool);
+  };
+  void diffuse(SpawnerID);
+  void diffuse(const SpawnerID*, int);
+  void rediffuseChanges(SpawnerID);
+  void wakeChunks(SpawnerID);
+  void settleScent(SpawnerID);
+  void diffuseRows(int, int);
+  void relaxRows(int, int, int);
+  void sweepRows(int, int, int);
+  void clearMarks();
+  void clearObjectives(SpawnerID);
+  /* Note a change to the unit in the journal and in each plane's changed
+     list, keeping its chunk awake for the plane's next pass */
+  void logChange(unsigned int i) {
+    if (!journaled.test(i)) {
+      journaled.set(i);
+      journal.push_back({i, types[i]});
+    }
+    for (unsigned int s = 0; s < planes.size(); s++) {
+      ScentPlane &plane = planes[s];
+      if (!plane.changed.test(i)) {
+        plane.changed.set(i);
+        plane.changedList.push_back(i);
+        keepAwake(i, (SpawnerID)s);
+      }
+    }
+  };
+  void clearJournal();
+  void setType(unsigned int, UnitType);
+  void loadTerrain(const unsigned char*);
+  void refreshDoor(unsigned int);
+  bool isPassable(unsigned int i, SpawnerID s) {
+    return occupancy[UNIT_TYPE_EMPTY].test(i) || openDoors[s].test(i);
+  };
+  bool clipRect(int&, int&, int&, int&);
+  int rectArea(int, int, int, int);
+  int countRect(UnitType, int, int, int, int);
+  unsigned int indexOf(int, int);
+  int xOf(unsigned int);
+  int yOf(unsigned int);
+  unsigned int neighbor(unsigned int, int, int);
+  MapUnit unitAt(unsigned int);
+  MapUnit unitAt(int, int);
+};
+
+/* A run of units of one row that are contiguous in the grid arrays; units
+   start .. start + length - 1 are at x .. x + length - 1 */
+struct RowSpan {
+  unsigned int start;
+  int x, y, length;
+  unsigned int end() {return start + length;};
+};
+
+/* A rectangle of the map, clipped to its edges, visited as row spans from the
+   top left to the bottom right:
+     for (RowSpan r = view.first(); r.length > 0; r = view.next(r))
+   In row major layout each row of the rectangle is a single span */
+class RectView {
+public:
+  MapGrid *grid;
+  int x, y, w, h;
+  RectView(MapGrid*, int, int, int, int);
+  RowSpan first() {return spanFrom(x, y);};
+  RowSpan next(RowSpan s) {
+    return (s.x + s.length < x + w) ? spanFrom(s.x + s.length, s.y)
+                                    : spanFrom(x, s.y + 1);
+  };
+private:
+  RowSpan spanFrom(int, int);
+};
+
+/* Spread the low 16 bits of v out to the even bits */
+inline unsigned int mortonSpread(unsigned int v) {
+  v &= 0x0000FFFF;
+  v = (v | (v << 8)) & 0x00FF00FF;
+  v = (v | (v << 4)) & 0x0F0F0F0F;
+  v = (v | (v << 2)) & 0x33333333;
+  v = (v | (v << 1)) & 0x55555555;
+  return v;
+}
+
+/* Gather the even bits of v back into the low 16 bits */
+inline unsigned int mortonCompact(unsigned int v) {
+  v &= 0x55555555;
+  v = (v | (v >> 1)) & 0x33333333;
+  v = (v | (v >> 2)) & 0x0F0F0F0F;
+  v = (v | (v >> 4)) & 0x00FF00FF;
+  v = (v | (v >> 8)) & 0x0000FFFF;
+  return v;
+}
+
+/* Index of the unit at (x, y); x and y may be -1 or size to reach the
+   border */
+inline unsigned int MapGrid::indexOf(int x, int y) {
+  unsigned int px = x + 1;
+  unsigned int py = y + 1;
+  unsigned int mask = (1u << tileShift) - 1;
+  switch (layout) {
+  case GRID_LAYOUT_TILED_8:
+  case GRID_LAYOUT_TILED_16:
+    return ((((py >> tileShift) * tilesPerRow + (px >> tileShift))
+             << (2 * tileShift)) |
+            ((py & mask) << tileShift) | (px & mask));
+  case GRID_LAYOUT_MORTON:
+    return mortonSpread(px) | (mortonSpread(py) << 1);
+  default:
+    return py * stride + px;
+  }
+}
+
+inline int MapGrid::xOf(unsigned int index) {
+  switch (layout) {
+  case GRID_LAYOUT_TILED_8:
+  case GRID_LAYOUT_TILED_16:
+    return ((((index >> (2 * tileShift)) % tilesPerRow) << tileShift) |
+            (index & ((1u << tileShift) - 1))) - 1;
+  case GRID_LAYOUT_MORTON:
+    return mortonCompact(index) - 1;
+  default:
+    return index % stride - 1;
+  }
+}
+
+inline int MapGrid::yOf(unsigned int index) {
+  switch (layout) {
+  case GRID_LAYOUT_TILED_8:
+  case GRID_LAYOUT_TILED_16:
+    return ((((index >> (2 * tileShift)) / tilesPerRow) << tileShift) |
+            ((index >> tileShift) & ((1u << tileShift) - 1))) - 1;
+  case GRID_LAYOUT_MORTON:
+    return mortonCompact(index >> 1) - 1;
+  default:
+    return index / stride - 1;
+  }
+}
+
+/* Index of the unit dx across and dy down from the unit at index */
+inline unsigned int MapGrid::neighbor(unsigned int index, int dx, int dy) {
+  if (layout == GRID_LAYOUT_ROW_MAJOR)
+    return index + dy * stride + dx;
+  return indexOf(xOf(index) + dx, yOf(index) + dy);
+}
+
+inline RectView::RectView(MapGrid *g, int rx, int ry, int rw, int rh)
+    : grid(g), x(rx), y(ry), w(rw), h(rh) {
+  if (!grid->clipRect(x, y, w, h))
+    h = 0;
+}
+
+inline RowSpan RectView::spanFrom(int sx, int sy) {
+  RowSpan s = {0, sx, sy, 0};
+  if (sy >= y + h)
+    return s;
+  s.start = grid->indexOf(sx, sy);
+  if (grid->layout == GRID_LAYOUT_ROW_MAJOR) {
+    s.length = x + w - sx;
+  } else {
+    s.length = 1;
+    while (sx + s.length < x + w &&
+           grid->indexOf(sx + s.length, sy) == s.start + s.length)
+      s.length++;
+  }
+  return s;
+}
+
+#endif
@@ -1,89 +1,95 @@
 #ifndef MAPUNIT_H
 #define MAPUNIT_H
 
-#include <map>
 #include <list>
 
 #include "event.h"
+#include "mapgrid.h"
 
-typedef enum UnitType {
-  UNIT_TYPE_EMPTY,
-  UNIT_TYPE_BUILDING,
-  UNIT_TYPE_AGENT,
-  UNIT_TYPE_SPAWNER,
-  UNIT_TYPE_WALL,
-  UNIT_TYPE_DOOR,
-  UNIT_TYPE_OUTSIDE
-} UnitType;
-
-class Agent;
-class Building;
-class Game;
-struct Objective;
 class Spawner;
 
-struct Door {
-  SpawnerID sid;
-  int hp;
-  bool isEmpty;
-};
-
-typedef struct MapUnitPerPlayerData {
-  Objective* objective;
-  double scent;
-  double prevScent;
-  double diffusion;
-} MapUnitPerPlayerData;
-
+/* A thin view of one unit of the map; all of its state lives in the MapGrid
+   arrays at position index */
 struct MapUnit {
-  /* An iterator for traversing through a predefined rectangle of mapunits */
-  class iterator {
-  public:
-    bool hasNextUnit;
-    MapUnit* current;
-    MapUnit* firstInRow;
-    int j, i, w, h;
-    iterator(MapUnit* first, int w_, int h_): hasNextUnit(true), \
-    current(first), firstInRow(first), j(0), i(0), w(w_), h(h_){};
-    iterator operator++() {iterator it = *this; next(); return it;};
-    iterator operator++(int junk) {next(); return *this;};
-    MapUnit& operator*() {return *current;};
-    MapUnit* operator->() {return current;};
-    void next();
-    bool hasNext() {return hasNextUnit;};
+  class iterator;
+  MapGrid* grid;
+  unsigned int index;
+  MapUnit(): grid(nullptr), index(0) {};
+  MapUnit(MapGrid* g, unsigned int i): grid(g), index(i) {};
+  int x() const {return grid->xOf(index);};
+  int y() const {return grid->yOf(index);};
+  UnitType type() {return grid->types[index];};
+  void setType(UnitType t) {grid->setType(index, t);};
+  int& hp() {return grid->hps[index];};
+  Agent*& agent() {return grid->agents[index];};
+  Building*& building() {return grid->buildings[index];};
+  Door& door() {return grid->doors[index];};
+  /* Must be called after changing door() so the open door bits, and with
+     them where scent diffuses, follow */
+  void refreshDoor() {grid->refreshDoor(index);};
+  Scent& scent(SpawnerID s) {return grid->planes[s].scent[index];};
+  Objective* objective(SpawnerID s) {
+    ScentPlane &plane = grid->planes[s];
+    return (plane.objectiveEpochs[index] == plane.epoch)
+               ? plane.objectives[index] : nullptr;
+  };
+  void setObjective(SpawnerID s, Objective* o) {
+    ScentPlane &plane = grid->planes[s];
+    plane.objectives[index] = o;
+    plane.objectiveEpochs[index] = plane.epoch;
   };
-  unsigned int x, y, index;
-  int hp;
-  UnitType type;
-  std::map<SpawnerID, MapUnitPerPlayerData> playerDict;
-  Agent* agent;
-  Game* game;
-  Door *door;
-  Building *building;
-  bool marked;
-  MapUnit* up;
-  MapUnit* down;
-  MapUnit* left;
-  MapUnit* right;
-  MapUnit(Game*);
-  MapUnit(Game*, int, int);
+  MapUnit up() {return MapUnit(grid, grid->neighbor(index, 0, -1));};
+  MapUnit down() {return MapUnit(grid, grid->neighbor(index, 0, 1));};
+  MapUnit left() {return MapUnit(grid, grid->neighbor(index, -1, 0));};
+  MapUnit right() {return MapUnit(grid, grid->neighbor(index, 1, 0));};
+  bool operator==(const MapUnit& other) const {return index == other.index;};
+  bool operator!=(const MapUnit& other) const {return index != other.index;};
   void setScent(double);
   void setEmptyNeighborScents(double);
   void clearScent();
-  bool isMarked();
-  void mark();
+  bool isMarked() {return grid->marks[index] == grid->markEpoch;};
+  void mark() {grid->marks[index] = grid->markEpoch;};
   /* Create an iterator through a rectangle of mapunits starting with this one
      at the top left */
-  iterator getIterator(int w, int h) {return iterator(this, w, h);};
-  void update();
-  ~MapUnit();
+  iterator getIterator(int, int);
+};
+
+/* An iterator for traversing through a predefined rectangle of mapunits; the
+   rectangle is clipped to the edges of the map when it is created */
+class MapUnit::iterator {
+public:
+  bool hasNextUnit;
+  MapUnit current;
+  MapUnit firstInRow;
+  int j, i, w, h;
+  iterator(MapUnit first, int w_, int h_): current(first), firstInRow(first), \
+  j(0), i(0) {
+    w = (w_ < (int)(first.grid->size - first.x())) ? w_ : first.grid->size - first.x();
+    h = (h_ < (int)(first.grid->size - first.y())) ? h_ : first.grid->size - first.y();
+    hasNextUnit = (w > 0 && h > 0);
+  };
+  iterator operator++() {iterator it = *this; next(); return it;};
+  iterator operator++(int junk) {next(); return *this;};
+  MapUnit& operator*() {return current;};
+  MapUnit* operator->() {return &current;};
+  void next();
+  bool hasNext() {return hasNextUnit;};
 };
 
+inline MapUnit::iterator MapUnit::getIterator(int w, int h) {
+  return iterator(*this, w, h);
+}
+
+inline MapUnit MapGrid::unitAt(unsigned int i) { return MapUnit(this, i); }
+inline MapUnit MapGrid::unitAt(int x, int y) {
+  return MapUnit(this, indexOf(x, y));
+}
+
 class concentric_iterator {
 private:
   void update_current();
 public:
-  std::list<MapUnit*> current;
+  std::list<MapUnit> current;
   int r, R, x, y, w, h;
   Game *g;
   concentric_iterator(Game*, int, int, int, int);
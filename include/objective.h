@@ -2,9 +2,11 @@
 #define OBJECTIVE_H
 
 #include <SDL2/SDL_rect.h>
+#include <stddef.h>
 #include <deque>
 
 #include "mapunit.h"
+#include "pool.h"
 
 enum ObjectiveType {
   OBJECTIVE_TYPE_BUILD_WALL,
@@ -28,8 +30,11 @@ struct Objective {
   concentric_iterator *citer;
   Game* game;
   SDL_Rect region;
+  static Pool<Objective> pool;
+  static void *operator new(size_t) {return pool.allocate();};
+  static void operator delete(void *p) {pool.release(p);};
   Objective(ObjectiveType, int, Game*, SDL_Rect, SpawnerID);
-  MapUnit::iterator getIterator();
+  RectView getView();
   bool isDone();
   bool regionIsReadyForBuilding();
   void updateCiter(UnitType, int);
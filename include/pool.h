@@ -0,0 +1,113 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+#include <new>
+#include <vector>
+
+/* Free list of slots for objects of type T, carved out of one block that is
+   allocated up front by reserve. Once every slot is taken allocate falls
+   back to the heap, so a low estimate costs speed, not correctness */
+template<class T>
+class Pool {
+private:
+  struct Slot {
+    alignas(T) unsigned char bytes[sizeof(T)];
+  };
+  std::vector<Slot> slots;
+  std::vector<void*> freeSlots;
+public:
+  bool owns(void *p) {
+    return !slots.empty() && p >= (void *)slots.data() &&
+           p < (void *)(slots.data() + slots.size());
+  };
+  /* Only takes effect while no slot is in use */
+  void reserve(size_t n) {
+    if (n <= slots.size() || freeSlots.size() != slots.size())
+      return;
+    slots.assign(n, Slot());
+    freeSlots.clear();
+    freeSlots.reserve(n);
+    for (size_t i = n; i > 0; i--)
+      freeSlots.push_back(&slots[i - 1]);
+  };
+  void *allocate() {
+    if (freeSlots.empty())
+      return ::operator new(sizeof(T));
+    void *p = freeSlots.back();
+    freeSlots.pop_back();
+    return p;
+  };
+  void release(void *p) {
+    if (owns(p))
+      freeSlots.push_back(p);
+    else
+      ::operator delete(p);
+  };
+};
+
+/* Free list of fixed size slots for the nodes of a node based container,
+   whose node type the code using it can't name. reserve sizes the slots
+   from an upper bound on the node size; a bigger request, or one made once
+   every slot is taken, comes from the heap */
+class NodePool {
+private:
+  std::vector<max_align_t> block;
+  size_t slotBytes;
+  std::vector<void*> freeSlots;
+public:
+  NodePool(): slotBytes(0) {};
+  bool owns(void *p) {
+    return !block.empty() && p >= (void *)block.data() &&
+           p < (void *)(block.data() + block.size());
+  };
+  /* Only takes effect while no slot is in use */
+  void reserve(size_t n, size_t bytes) {
+    if (freeSlots.size() * slotBytes != block.size() * sizeof(max_align_t))
+      return;
+    size_t words = (bytes + sizeof(max_align_t) - 1) / sizeof(max_align_t);
+    slotBytes = words * sizeof(max_align_t);
+    block.assign(n * words, max_align_t());
+    freeSlots.clear();
+    freeSlots.reserve(n);
+    for (size_t i = n; i > 0; i--)
+      freeSlots.push_back(&block[(i - 1) * words]);
+  };
+  void *allocate(size_t bytes) {
+    if (bytes > slotBytes || freeSlots.empty())
+      return ::operator new(bytes);
+    void *p = freeSlots.back();
+    freeSlots.pop_back();
+    return p;
+  };
+  void release(void *p) {
+    if (owns(p))
+      freeSlots.push_back(p);
+    else
+      ::operator delete(p);
+  };
+};
+
+/* Allocator that takes its nodes from a NodePool; every rebound copy shares
+   the pool */
+template<class T>
+struct NodeAllocator {
+  typedef T value_type;
+  NodePool *pool;
+  NodeAllocator(NodePool *p): pool(p) {};
+  template<class U>
+  NodeAllocator(const NodeAllocator<U> &other): pool(other.pool) {};
+  T *allocate(size_t n) { return (T *)pool->allocate(n * sizeof(T)); };
+  void deallocate(T *p, size_t) { pool->release(p); };
+  template<class U>
+  bool operator==(const NodeAllocator<U> &other) const {
+    return pool == other.pool;
+  };
+  template<class U>
+  bool operator!=(const NodeAllocator<U> &other) const {
+    return pool != other.pool;
+  };
+};
+
+#endif
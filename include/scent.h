@@ -0,0 +1,35 @@
+#ifndef SCENT_H
+#define SCENT_H
+
+#include "constants.h"
+
+/* How each unit stores its scent. Float or a fixed point 16 bit scent
+   would shrink the scent planes, but scent falls off by about two thirds of
+   a decade a unit away from a source, so how far it carries depends on
+   where it is flushed to zero, not on the mantissa: from a source held at
+   255, fixed point ran out after 6 units and float, which can't go below
+   the smallest normal float, after about 60, short of the 100 and 200 maps.
+   So scent is a double, flushed at SCENT_EPSILON, and everything that
+   stores or diffuses it goes through Scent and the functions below.
+   SCENT_REACH is about how many units from such a source the settled plume
+   is still above zero */
+typedef double Scent;
+const Scent SCENT_COEFF = (Scent)SCENT_DIFFUSION;
+const int SCENT_REACH = 230;
+/* Diffused scent at or below this is flushed to exactly zero, so quiet
+   regions drop out of diffusion rather than trailing off into denormals.
+   The scent that would have been kept is lost, so the far tail of a plume
+   comes out slightly smaller than without the flush */
+const Scent SCENT_FLUSH = SCENT_EPSILON;
+
+inline Scent toScent(double s) { return (Scent)s; }
+
+inline double fromScent(Scent s) { return s; }
+
+inline Scent diffuseScent(Scent coeff, Scent left, Scent up, Scent right,
+                          Scent down) {
+  Scent s = coeff * (left + up + right + down);
+  return (s > SCENT_FLUSH) ? s : 0;
+}
+
+#endif
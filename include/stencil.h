@@ -0,0 +1,33 @@
+#ifndef STENCIL_H
+#define STENCIL_H
+
+#include "scent.h"
+
+/* One row of the diffusion stencil over contiguous scent:
+     out[k] = diffuseScent(coeff[k], left[k], up[k], right[k], down[k])
+   for k < w, returning the largest out[k] as a double, or 0 if none is
+   larger. out must not overlap the inputs. Every version works in the same
+   order with no fused operations, so they all give the same bits as the
+   scalar reference */
+typedef double (*StencilRow)(Scent*, const Scent*, const Scent*, const Scent*,
+                             const Scent*, const Scent*, int);
+
+typedef enum StencilISA {
+  STENCIL_ISA_SCALAR,
+  STENCIL_ISA_SSE2,
+  STENCIL_ISA_AVX2,
+  STENCIL_ISA_AVX512
+} StencilISA;
+
+extern const char *stencilISANames[STENCIL_ISA_AVX512 + 1];
+
+/* How bestStencilISA times the versions against each other */
+const int STENCIL_TIMING_SPANS = 256;
+const int STENCIL_TIMING_ROUNDS = 200;
+
+bool stencilSupported(StencilISA);
+double stencilSpanTime(StencilRow);
+StencilISA bestStencilISA();
+StencilRow stencilRowFor(StencilISA);
+
+#endif
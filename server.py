@@ -228,17 +228,29 @@ class Lobby:
         
     async def game(self):
         random.shuffle(self.players)
+        mapMismatch = False
         with trio.move_on_after(FRAME_TIMEOUT) as cancel_scope:
             for playernum in range(len(self.players)):
                 websocket = self.players[playernum]
                 await websocket.send(self.pairString)
+                # "Ready <map hash>"; every player must be on the same map
                 readymsg = await websocket.receive()
+                if (playernum == 0):
+                    firstReadymsg = readymsg
+                elif readymsg != firstReadymsg:
+                    mapMismatch = True
+                    await MainLogger.log("Players have different maps", opt=self)
+                    await self.broadcast("MAP_MISMATCH", range(len(self.players)))
+                    break
                 await websocket.send(f"P{str(playernum + 1)}")
                 setmsg = await websocket.receive()
                 if (playernum == 0):
                     await websocket.send("Go")
                     startmsg = await websocket.receive()
-        if not cancel_scope.cancelled_caught:
+        if mapMismatch:
+            [websocket.gameStarted.set() for websocket in self.players]
+            [websocket.gameFinished.set() for websocket in self.players]
+        elif not cancel_scope.cancelled_caught:
             [websocket.gameStarted.set() for websocket in self.players]
             await MainLogger.log("Game started", opt=self)
             async with SessionGamesPlayed.lock:
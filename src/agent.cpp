@@ -6,17 +6,20 @@
 #include "game.h"
 #include "mapunit.h"
 
-Agent::Agent(Game *g, MapUnit *m, AgentID i, SpawnerID s)
+Pool<Agent> Agent::pool;
+
+Agent::Agent(Game *g, MapUnit m, AgentID i, SpawnerID s)
     : id(i), sid(s), game(g), unit(m) {}
 
 /* should always call delete agt after agt.die() */
 void Agent::die() {
-  if (unit->type == UNIT_TYPE_AGENT) {
-    unit->type = UNIT_TYPE_EMPTY;
-  } else if (unit->type == UNIT_TYPE_DOOR) {
-    unit->door->isEmpty = true;
+  if (unit.type() == UNIT_TYPE_AGENT) {
+    unit.setType(UNIT_TYPE_EMPTY);
+  } else if (unit.type() == UNIT_TYPE_DOOR) {
+    unit.door().isEmpty = true;
+    unit.refreshDoor();
   }
-  unit->agent = nullptr;
+  unit.agent() = nullptr;
   game->agentDict.erase(id);
   game->numPlayerAgents[sid]--;
 }
@@ -25,83 +28,85 @@ void Agent::die() {
 void Agent::update(AgentEvent *aevent) {
   aevent->id = id;
   SpawnerID psid = game->getPlayerSpawnID();
+  game->grid.keepAwake(unit.index, psid);
   AgentDirection dirRef[5] = {AGENT_DIRECTION_LEFT, AGENT_DIRECTION_RIGHT,
                               AGENT_DIRECTION_UP, AGENT_DIRECTION_DOWN,
                               AGENT_DIRECTION_STAY};
-  MapUnit *neighbors[5] = {unit->left, unit->right, unit->up, unit->down, unit};
-  // Handle objectives at the neighbors of the agent
+  MapUnit neighbors[5] = {unit.left(), unit.right(), unit.up(), unit.down(),
+                          unit};
+  // Handle objectives at the neighbors of the agent; OUTSIDE units never carry
+  // an objective
   for (int i = 0; i < 5; i++) {
-    MapUnit *m = neighbors[i];
-    if ((m->type != UNIT_TYPE_OUTSIDE) &&
-        (m->playerDict[psid].objective != nullptr) && (!m->isMarked())) {
-      switch (m->playerDict[psid].objective->type) {
+    MapUnit m = neighbors[i];
+    if ((m.objective(psid) != nullptr) && (!m.isMarked())) {
+      switch (m.objective(psid)->type) {
       case OBJECTIVE_TYPE_BUILD_WALL:
-        if (canMoveTo(m) && m->type != UNIT_TYPE_DOOR) {
+        if (canMoveTo(m) && m.type() != UNIT_TYPE_DOOR) {
           aevent->dir = dirRef[i];
           aevent->action = AGENT_ACTION_BUILDWALL;
-          m->mark();
+          m.mark();
           return;
         }
         break;
       case OBJECTIVE_TYPE_BUILD_SUBSPAWNER:
-        if (m->type == UNIT_TYPE_EMPTY ||
-            (m->type == UNIT_TYPE_SPAWNER && m->hp < SUBSPAWNER_UNIT_COST)) {
+        if (m.type() == UNIT_TYPE_EMPTY ||
+            (m.type() == UNIT_TYPE_SPAWNER && m.hp() < SUBSPAWNER_UNIT_COST)) {
           aevent->dir = dirRef[i];
           aevent->action = AGENT_ACTION_BUILDSUBSPAWNER;
-          m->mark();
+          m.mark();
           return;
         }
         break;
       case OBJECTIVE_TYPE_BUILD_TOWER:
-        if (m->type == UNIT_TYPE_EMPTY &&
-            m->playerDict[psid].objective->regionIsReadyForBuilding()) {
+        if (m.type() == UNIT_TYPE_EMPTY &&
+            m.objective(psid)->regionIsReadyForBuilding()) {
           aevent->dir = dirRef[i];
           aevent->action = AGENT_ACTION_BUILDTOWER;
-          for (MapUnit::iterator it =
-                   m->playerDict[psid].objective->getIterator();
-               it.hasNext(); it++) {
-            it->mark();
+          RectView view = m.objective(psid)->getView();
+          for (RowSpan r = view.first(); r.length > 0; r = view.next(r)) {
+            for (unsigned int j = r.start; j < r.end(); j++)
+              m.grid->marks[j] = m.grid->markEpoch;
           }
           return;
         }
-        if (m->type == UNIT_TYPE_BUILDING && m->building->sid == sid) {
+        if (m.type() == UNIT_TYPE_BUILDING && m.building()->sid == sid) {
           aevent->dir = dirRef[i];
           aevent->action = AGENT_ACTION_BUILDTOWER;
-          m->mark();
+          m.mark();
           return;
         }
         break;
       case OBJECTIVE_TYPE_BUILD_BOMB:
-        if (m->type == UNIT_TYPE_EMPTY &&
-            m->playerDict[psid].objective->regionIsReadyForBuilding()) {
+        if (m.type() == UNIT_TYPE_EMPTY &&
+            m.objective(psid)->regionIsReadyForBuilding()) {
           aevent->dir = dirRef[i];
           aevent->action = AGENT_ACTION_BUILDBOMB;
-          for (MapUnit::iterator it =
-                   m->playerDict[psid].objective->getIterator();
-               it.hasNext(); it++) {
-            it->mark();
+          RectView view = m.objective(psid)->getView();
+          for (RowSpan r = view.first(); r.length > 0; r = view.next(r)) {
+            for (unsigned int j = r.start; j < r.end(); j++)
+              m.grid->marks[j] = m.grid->markEpoch;
           }
           return;
         }
-        if (m->type == UNIT_TYPE_BUILDING && m->building->sid == sid) {
+        if (m.type() == UNIT_TYPE_BUILDING && m.building()->sid == sid) {
           aevent->dir = dirRef[i];
           aevent->action = AGENT_ACTION_BUILDBOMB;
-          m->mark();
+          m.mark();
           return;
         }
         break;
       case OBJECTIVE_TYPE_BUILD_DOOR:
-        switch (m->type) {
+        switch (m.type()) {
         case UNIT_TYPE_WALL:
           aevent->dir = dirRef[i];
           aevent->action = AGENT_ACTION_BUILDDOOR;
-          m->mark();
+          m.mark();
           return;
         case UNIT_TYPE_DOOR:
-          if (m->door->sid == sid && m->door->hp < MAX_DOOR_HEALTH) {
+          if (m.door().sid == sid && m.door().hp < MAX_DOOR_HEALTH) {
             aevent->dir = dirRef[i];
             aevent->action = AGENT_ACTION_BUILDDOOR;
-            m->mark();
+            m.mark();
             return;
           }
           break;
@@ -110,37 +115,37 @@ void Agent::update(AgentEvent *aevent) {
         }
         break;
       case OBJECTIVE_TYPE_ATTACK:
-        switch (m->type) {
+        switch (m.type()) {
         case UNIT_TYPE_WALL:
           aevent->dir = dirRef[i];
           aevent->action = AGENT_ACTION_ATTACK;
-          m->mark();
+          m.mark();
           return;
         case UNIT_TYPE_AGENT:
-          if (m->agent->getSpawnID() != sid) {
+          if (m.agent()->getSpawnID() != sid) {
             aevent->dir = dirRef[i];
             aevent->action = AGENT_ACTION_ATTACK;
-            m->mark();
+            m.mark();
             return;
           }
           break;
         case UNIT_TYPE_SPAWNER:
           aevent->dir = dirRef[i];
           aevent->action = AGENT_ACTION_ATTACK;
-          m->mark();
+          m.mark();
           return;
         case UNIT_TYPE_DOOR:
-          if (m->door->sid != sid) {
+          if (m.door().sid != sid) {
             aevent->dir = dirRef[i];
             aevent->action = AGENT_ACTION_ATTACK;
-            m->mark();
+            m.mark();
             return;
           }
           break;
         case UNIT_TYPE_BUILDING:
           aevent->dir = dirRef[i];
           aevent->action = AGENT_ACTION_ATTACK;
-          m->mark();
+          m.mark();
           return;
           break;
         default:
@@ -153,18 +158,23 @@ void Agent::update(AgentEvent *aevent) {
     }
   }
   // Code for choosing a scent at random (weighted)
-  MapUnit *unitOpts[4] = {unit->left, unit->right, unit->up, unit->down};
-  double scents[4];
+  MapUnit unitOpts[4] = {unit.left(), unit.right(), unit.up(), unit.down()};
+  Scent scents[4];
   for (int i = 0; i < 4; i++) {
-    scents[i] = unitOpts[i]->playerDict[psid].scent;
+    scents[i] = unitOpts[i].scent(psid);
   }
   /* Do a weighted random selection of where to go, based on the scent in each
   square */
-  double total = 0.0;
+  Scent total = 0;
   for (int i = 0; i < 4; i++)
     total += scents[i];
+  /* Nothing to follow close by, so take a heading from the coarse levels */
+  if (total == 0 && game->grid.coarseScents(unit.index, psid, scents)) {
+    for (int i = 0; i < 4; i++)
+      total += scents[i];
+  }
   int choice = rand() % 4;
-  double rnd = ((double)rand() / (double)RAND_MAX) * total;
+  Scent rnd = ((double)rand() / (double)RAND_MAX) * total;
   if (total > 0.0 && rnd > 0.0) {
     for (int i = 0; i < 4; i++) {
       if (rnd < scents[i]) {
@@ -177,23 +187,19 @@ void Agent::update(AgentEvent *aevent) {
   if (canMoveTo(unitOpts[choice])) {
     aevent->dir = dirRef[choice];
     aevent->action = AGENT_ACTION_MOVE;
-    unitOpts[choice]->mark();
+    unitOpts[choice].mark();
   } else {
     aevent->action = AGENT_ACTION_STAY;
     aevent->dir = AGENT_DIRECTION_STAY;
   }
 }
 
-bool Agent::canMoveTo(MapUnit *destUnit) {
-  if (destUnit->isMarked())
+bool Agent::canMoveTo(MapUnit destUnit) {
+  if (destUnit.isMarked())
     return false;
   if (destUnit == unit)
     return true;
-  if (destUnit->type == UNIT_TYPE_DOOR) {
-    return (destUnit->door->sid == sid &&
-            destUnit->door->hp == MAX_DOOR_HEALTH && destUnit->door->isEmpty);
-  }
-  return (destUnit->type == UNIT_TYPE_EMPTY);
+  return destUnit.grid->isPassable(destUnit.index, sid);
 }
 
 SpawnerID Agent::getSpawnID() { return sid; }
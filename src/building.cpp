@@ -15,9 +15,8 @@ Building::Building(Game *g, BuildingType t, SpawnerID s, int x, int y, int w,
   center = game->mapUnitAt(x + w / 2, y + h / 2);
 }
 
-MapUnit::iterator Building::getIterator() {
-  MapUnit *first = game->mapUnitAt(region.x, region.y);
-  return first->getIterator(region.w, region.h);
+RectView Building::getView() {
+  return RectView(center.grid, region.x, region.y, region.w, region.h);
 }
 
 bool Building::canUpdate() {
@@ -28,9 +27,12 @@ bool Building::canUpdate() {
 Tower::Tower(Game *g, SpawnerID s, int x, int y)
     : Building(g, BUILDING_TYPE_TOWER, s, x, y, TOWER_SIZE, TOWER_SIZE,
                MAX_TOWER_HEALTH, TOWER_UPDATE_TIME) {
-  for (MapUnit::iterator it = getIterator(); it.hasNext(); it++) {
-    it->type = UNIT_TYPE_BUILDING;
-    it->building = this;
+  RectView view = getView();
+  for (RowSpan r = view.first(); r.length > 0; r = view.next(r)) {
+    for (unsigned int i = r.start; i < r.end(); i++) {
+      view.grid->setType(i, UNIT_TYPE_BUILDING);
+      view.grid->buildings[i] = this;
+    }
   }
 }
 
@@ -44,8 +46,8 @@ void Tower::update(TowerEvent *tevent) {
     std::vector<AgentID> potentialIDs;
     for (auto it = game->agentDict.begin(); it != game->agentDict.end(); it++) {
       if (it->second->sid != sid) {
-        int dx = it->second->unit->x - center->x;
-        int dy = it->second->unit->y - center->y;
+        int dx = it->second->unit.x() - center.x();
+        int dy = it->second->unit.y() - center.y();
         if ((dx * dx) + (dy * dy) < TOWER_AOE_RADIUS_SQUARED) {
           potentialIDs.push_back(it->first);
         }
@@ -55,8 +57,8 @@ void Tower::update(TowerEvent *tevent) {
       tevent->destroyed = true;
       int choice = rand() % potentialIDs.size();
       tevent->id = potentialIDs.at(choice);
-      tevent->x = center->x;
-      tevent->y = center->y;
+      tevent->x = center.x();
+      tevent->y = center.y();
     }
   }
 }
@@ -64,20 +66,20 @@ void Tower::update(TowerEvent *tevent) {
 Spawner::Spawner(Game *g, SpawnerID s, int x, int y)
     : Building(g, BUILDING_TYPE_SPAWNER, s, x, y, SPAWNER_SIZE, SPAWNER_SIZE, 1,
                SPAWNER_UPDATE_TIME) {
-  for (MapUnit::iterator it = getIterator(); it.hasNext(); it++) {
-    it->type = UNIT_TYPE_SPAWNER;
-    it->hp = SUBSPAWNER_UNIT_COST;
-    it->building = this;
+  RectView view = getView();
+  for (RowSpan r = view.first(); r.length > 0; r = view.next(r)) {
+    for (unsigned int i = r.start; i < r.end(); i++) {
+      view.grid->setType(i, UNIT_TYPE_SPAWNER);
+      view.grid->hps[i] = SUBSPAWNER_UNIT_COST;
+      view.grid->buildings[i] = this;
+    }
   }
   ready = true;
 }
 
 bool Spawner::isDestroyed() {
-  for (MapUnit::iterator m = getIterator(); m.hasNext(); m++) {
-    if (m->type == UNIT_TYPE_SPAWNER)
-      return false;
-  }
-  return true;
+  return center.grid->countRect(UNIT_TYPE_SPAWNER, region.x, region.y,
+                               region.w, region.h) == 0;
 }
 
 void Spawner::update(SpawnerEvent *sevent) {
@@ -92,12 +94,8 @@ void Spawner::update(SpawnerEvent *sevent) {
 }
 
 int Spawner::getNumSpawnUnits() {
-  int count = 0;
-  for (MapUnit::iterator m = getIterator(); m.hasNext(); m++) {
-    if (m->type == UNIT_TYPE_SPAWNER)
-      count++;
-  }
-  return count;
+  return center.grid->countRect(UNIT_TYPE_SPAWNER, region.x, region.y,
+                               region.w, region.h);
 }
 
 bool Spawner::canSpawnAgent(int *retx, int *rety) {
@@ -119,11 +117,11 @@ bool Spawner::canSpawnAgent(int *retx, int *rety) {
   if (spawnX < 0 || spawnX >= game->getSize() || spawnY < 0 ||
       spawnY >= game->getSize())
     return false;
-  MapUnit *uptr = game->mapUnitAt(spawnX, spawnY);
-  if (uptr->type == UNIT_TYPE_EMPTY && !uptr->isMarked()) {
+  MapUnit uptr = game->mapUnitAt(spawnX, spawnY);
+  if (uptr.type() == UNIT_TYPE_EMPTY && !uptr.isMarked()) {
     *retx = spawnX;
     *rety = spawnY;
-    uptr->mark();
+    uptr.mark();
     return true;
   } else {
     return false;
@@ -133,26 +131,32 @@ bool Spawner::canSpawnAgent(int *retx, int *rety) {
 Subspawner::Subspawner(Game *g, SpawnerID s, int x, int y)
     : Building(g, BUILDING_TYPE_SUBSPAWNER, s, x, y, SUBSPAWNER_SIZE,
                SUBSPAWNER_SIZE, 1, SUBSPAWNER_UPDATE_TIME) {
-  for (MapUnit::iterator it = getIterator(); it.hasNext(); it++) {
-    it->building = this;
+  RectView view = getView();
+  for (RowSpan r = view.first(); r.length > 0; r = view.next(r)) {
+    for (unsigned int i = r.start; i < r.end(); i++)
+      view.grid->buildings[i] = this;
   }
 }
 
 bool Subspawner::isDestroyed() {
-  for (MapUnit::iterator m = getIterator(); m.hasNext(); m++) {
-    if (m->type == UNIT_TYPE_SPAWNER)
-      return false;
-  }
-  return true;
+  return center.grid->countRect(UNIT_TYPE_SPAWNER, region.x, region.y,
+                               region.w, region.h) == 0;
 }
 
 void Subspawner::update(SpawnerEvent *sevent) {
   sevent->created = false;
-  if (!ready) {
+  /* Only look at the health of each unit once they are all spawner units */
+  if (!ready && center.grid->countRect(UNIT_TYPE_SPAWNER, region.x, region.y,
+                                       region.w, region.h) ==
+                    center.grid->rectArea(region.x, region.y, region.w,
+                                          region.h)) {
     ready = true;
-    for (MapUnit::iterator m = getIterator(); m.hasNext(); m++) {
-      if (m->type != UNIT_TYPE_SPAWNER || m->hp < SUBSPAWNER_UNIT_COST)
-        ready = false;
+    RectView view = getView();
+    for (RowSpan r = view.first(); r.length > 0; r = view.next(r)) {
+      for (unsigned int i = r.start; i < r.end(); i++) {
+        if (view.grid->hps[i] < SUBSPAWNER_UNIT_COST)
+          ready = false;
+      }
     }
   }
   if (canUpdate()) {
@@ -183,11 +187,11 @@ bool Subspawner::canSpawnAgent(int *retx, int *rety) {
   if (spawnX < 0 || spawnX >= game->getSize() || spawnY < 0 ||
       spawnY >= game->getSize())
     return false;
-  MapUnit *uptr = game->mapUnitAt(spawnX, spawnY);
-  if (uptr->type == UNIT_TYPE_EMPTY && !uptr->isMarked()) {
+  MapUnit uptr = game->mapUnitAt(spawnX, spawnY);
+  if (uptr.type() == UNIT_TYPE_EMPTY && !uptr.isMarked()) {
     *retx = spawnX;
     *rety = spawnY;
-    uptr->mark();
+    uptr.mark();
     return true;
   } else {
     return false;
@@ -198,9 +202,12 @@ Bomb::Bomb(Game *g, SpawnerID s, int x, int y)
     : Building(g, BUILDING_TYPE_BOMB, s, x, y, BOMB_SIZE, BOMB_SIZE,
                MAX_BOMB_HEALTH, 1) {
 
-  for (MapUnit::iterator it = getIterator(); it.hasNext(); it++) {
-    it->type = UNIT_TYPE_BUILDING;
-    it->building = this;
+  RectView view = getView();
+  for (RowSpan r = view.first(); r.length > 0; r = view.next(r)) {
+    for (unsigned int i = r.start; i < r.end(); i++) {
+      view.grid->setType(i, UNIT_TYPE_BUILDING);
+      view.grid->buildings[i] = this;
+    }
   }
 }
 
@@ -211,8 +218,8 @@ void Bomb::update(BombEvent *bevent) {
   if (hp == max_hp)
     ready = true;
   if (ready) {
-    bevent->x = center->x;
-    bevent->y = center->y;
+    bevent->x = center.x();
+    bevent->y = center.y();
     bevent->detonated = true;
   }
 }
@@ -0,0 +1,60 @@
+#include "diffusepool.h"
+
+#include "mapgrid.h"
+
+struct WorkerArgs {
+  DiffusePool *pool;
+  int band;
+};
+
+static void *workerMain(void *p) {
+  WorkerArgs *args = (WorkerArgs *)p;
+  DiffusePool *pool = args->pool;
+  int band = args->band;
+  delete args;
+  while (true) {
+    pthread_barrier_wait(&pool->start);
+    if (pool->quit)
+      break;
+    pool->band(band);
+    pthread_barrier_wait(&pool->done);
+  }
+  return nullptr;
+}
+
+DiffusePool::DiffusePool(MapGrid *g, int threads)
+    : grid(g), numThreads(threads), workers(threads - 1),
+      phase(-1), quit(false) {
+  pthread_barrier_init(&start, nullptr, numThreads);
+  pthread_barrier_init(&done, nullptr, numThreads);
+  for (int t = 1; t < numThreads; t++)
+    pthread_create(&workers[t - 1], nullptr, workerMain,
+                   new WorkerArgs{this, t});
+}
+
+DiffusePool::~DiffusePool() {
+  quit = true;
+  pthread_barrier_wait(&start);
+  for (pthread_t &worker : workers)
+    pthread_join(worker, nullptr);
+  pthread_barrier_destroy(&start);
+  pthread_barrier_destroy(&done);
+}
+
+void DiffusePool::run(int p) {
+  phase = p;
+  pthread_barrier_wait(&start);
+  band(0);
+  pthread_barrier_wait(&done);
+}
+
+/* Diffuse the chunk rows of band b in every plane of the pass */
+void DiffusePool::band(int b) {
+  int rows = grid->chunksPerRow;
+  int first = rows * b / numThreads;
+  int end = rows * (b + 1) / numThreads;
+  if (phase < 0)
+    grid->diffuseRows(first, end);
+  else
+    grid->relaxRows(first, end, phase);
+}
@@ -5,6 +5,7 @@
 #endif
 
 #include <pthread.h>
+#include <algorithm>
 #include <thread>
 #include <chrono>
 
@@ -19,6 +20,8 @@
 #include "constants.h"
 #include "display.h"
 #include "event.h"
+#include "heapbudget.h"
+#include "mapfile.h"
 #include "mapunit.h"
 #include "menu.h"
 #include "nethandler.h"
@@ -38,55 +41,34 @@
 
 /*---------Constructor / Destructor----------------*/
 
-Game::Game(int gm, int sz, int psz, double scl, char *pstr, char *uri, int np, bool mob)
-    : pairString(pstr), mobile(mob), flipped_X(false), flipped_Y(false), resignConfirmation(false), ended(false),
+Game::Game(int gm, int sz, int psz, double scl, char *pstr, char *uri, int np, bool mob, MapFile *mf)
+    : mapFile(mf), pairString(pstr), serverURI(uri), mobile(mob), flipped_X(false), flipped_Y(false), resignConfirmation(false), ended(false),
       eventsBufferCapacity(INIT_EVENT_BUFFER_SIZE),
       context(GAME_CONTEXT_CONNECTING),
       selectionContext(SELECTION_CONTEXT_UNSELECTED), initScale(scl),
-      scale(scl), turnNum(0), numPlayers(np), remainingPlayers(np), gameMode(gm), gameSize(sz), panelSize(psz), mouseX(0),
+      scale(scl), turnNum(0),
+      numPlayers(np < 2 ? 2 : (np > MAX_PLAYERS ? MAX_PLAYERS : np)),
+      remainingPlayers(numPlayers), gameMode(gm), gameSize(sz), panelSize(psz), mouseX(0),
       mouseY(0), placementW(0), placementH(0), zapCounter(1),
       secondsRemaining(GAME_TIME_SECONDS + STARTUP_TIME_SECONDS),
-      doneStatus(DONE_STATUS_INIT), newAgentID(1), outside(this),
-      selectedObjective(nullptr) {
-
-  turnMap[SPAWNER_ID_ONE] = 0;
-  turnMap[SPAWNER_ID_TWO] = 1;
-  turnMap[SPAWNER_ID_THREE] = 2;
-  turnMap[SPAWNER_ID_FOUR] = 3;
-  numPlayerAgents[SPAWNER_ID_ONE] = 0;
-  numPlayerAgents[SPAWNER_ID_TWO] = 0;
-  numPlayerAgents[SPAWNER_ID_THREE] = 0;
-  numPlayerAgents[SPAWNER_ID_FOUR] = 0;
+      grid(this, sz, numPlayers),
+      agentDict(AgentDict::allocator_type(&agentNodes)),
+      doneStatus(DONE_STATUS_INIT), newAgentID(1),
+      placingType(BUILDING_TYPE_TOWER), selectedObjective(nullptr) {
+
+  /* The color schemes name four teams, so keep at least four colors */
+  colorScheme.resize(numPlayers < 4 ? 4 : numPlayers);
+  bombTextures.resize(colorScheme.size(), nullptr);
+  numPlayerAgents.resize(numPlayers, 0);
   panelYDrawOffset = (mobile ? panelSize : 0);
+  /* Take everything the match can need now, so the heap stays put in play */
+  HeapBudget budget = planHeap(grid);
+  Agent::pool.reserve(budget.agentCap);
+  Objective::pool.reserve(budget.objectiveCap);
+  agentNodes.reserve(budget.agentCap, budget.nodeBytes);
+  eventsBufferCapacity = budget.eventCap;
   eventsBuffer = malloc(messageSize(eventsBufferCapacity));
   gameDisplaySize = scaleInt(gameSize);
-  mapUnits.reserve(gameSize * gameSize);
-  for (int i = 0; i < gameSize; i++) {
-    for (int j = 0; j < gameSize; j++) {
-      mapUnits.push_back(new MapUnit(this, j, i));
-    }
-  }
-  for (int i = 0; i < gameSize; i++) {
-    for (int j = 0; j < gameSize; j++) {
-      int index = i * gameSize + j;
-      if (i == 0)
-        mapUnits[index]->up = &outside;
-      else
-        mapUnits[index]->up = mapUnits[index - gameSize];
-      if (i == gameSize - 1)
-        mapUnits[index]->down = &outside;
-      else
-        mapUnits[index]->down = mapUnits[index + gameSize];
-      if (j == 0)
-        mapUnits[index]->left = &outside;
-      else
-        mapUnits[index]->left = mapUnits[index - 1];
-      if (j == gameSize - 1)
-        mapUnits[index]->right = &outside;
-      else
-        mapUnits[index]->right = mapUnits[index + 1];
-    }
-  }
 
   selection = {0, 0, 1, 1};
   menuSize = gameDisplaySize / MENU_ITEMS_IN_VIEW;
@@ -104,18 +86,9 @@ Game::Game(int gm, int sz, int psz, double scl, char *pstr, char *uri, int np, b
   view = {0, 0, gameSize, gameSize};
   selectedUnit = mapUnitAt(0, 0);
   menu = new Menu(this);
-  int p1offset = gameSize - SPAWNER_PADDING - SPAWNER_SIZE;
-  int p2offset = SPAWNER_PADDING;
-  buildingLists[BUILDING_TYPE_SPAWNER].push_back(
-      new Spawner(this, SPAWNER_ID_ONE, p1offset, p1offset));
-  buildingLists[BUILDING_TYPE_SPAWNER].push_back(
-      new Spawner(this, SPAWNER_ID_TWO, p2offset, p2offset));
-  if (numPlayers == 4) {
-    buildingLists[BUILDING_TYPE_SPAWNER].push_back(
-        new Spawner(this, SPAWNER_ID_THREE, p1offset, p2offset));
-    buildingLists[BUILDING_TYPE_SPAWNER].push_back(
-        new Spawner(this, SPAWNER_ID_FOUR, p2offset, p1offset));
-  }
+  if (mapFile)
+    grid.loadTerrain(mapFile->cells);
+  placeSpawners();
   objectiveInfoTextures[OBJECTIVE_TYPE_ATTACK] =
       disp->cacheTextWrapped("Objective - Attack", 0);
   objectiveInfoTextures[OBJECTIVE_TYPE_GOTO] =
@@ -134,18 +107,12 @@ Game::Game(int gm, int sz, int psz, double scl, char *pstr, char *uri, int np, b
   setColors(1, "RED", 255, 0, 0);
   setColors(2, "BLUE", 0, 0, 255);
   setColors(3, "YELLOW", 255, 255, 0);
+  setColors(4, "CYAN", 0, 255, 255);
+  setColors(5, "LAVENDER", 180, 160, 255);
+  setColors(6, "TEAL", 0, 128, 128);
+  setColors(7, "SALMON", 250, 128, 114);
   pthread_mutex_init(&threadLock, NULL);
-  switch(gameMode) {
-    case 0:
-      net = new NetHandler(this, pairString, uri);
-      break;
-    case 1:
-      simpleAggMode();
-      break;
-    case 2:
-      simpleDefMode();
-      break;
-  }
+  startMode();
 }
 
 Game::~Game() {
@@ -154,15 +121,6 @@ Game::~Game() {
   if (gameMode == 0) {
     delete net;
   }
-  for (MapUnit *u : mapUnits) {
-    u->left = nullptr;
-    u->right = nullptr;
-    u->down = nullptr;
-    u->up = nullptr;
-  }
-  for (unsigned int i = 0; i < mapUnits.size(); i++) {
-    delete mapUnits[i];
-  }
   for (auto it = agentDict.begin(); it != agentDict.end(); it++) {
     delete it->second;
   }
@@ -178,13 +136,12 @@ Game::~Game() {
   }
   towerZaps.clear();
   bombEffects.clear();
-  for (int i = 0; i < 4; i++) {
-    SDL_DestroyTexture(bombTextures[i]);
+  for (SDL_Texture *t : bombTextures) {
+    SDL_DestroyTexture(t);
   }
   objectiveInfoTextures.clear();
   agentDict.clear();
   buildingLists.clear();
-  mapUnits.clear();
   delete disp;
   delete menu;
   delete panel;
@@ -200,7 +157,8 @@ void Game::end(DoneStatus s) {
   std::string winningTeamName;
   int winningTeamNum;
   int idx;
-  int current_min;
+  int current_min = 0;
+  std::vector<Building *> spawns(numPlayers, nullptr);
   bool we_have_a_winner = false;
   switch (s) {
   case DONE_STATUS_WINRECV:
@@ -234,16 +192,16 @@ void Game::end(DoneStatus s) {
     closeText = "What! You shouldn't see this text!";
     break;
   case DONE_STATUS_TIMEOUT:
-    Building *spawns[4];
     for (Building *build : buildingLists[BUILDING_TYPE_SPAWNER]) {
       int teamNum = getTeamNum(build->sid);
       spawns[teamNum] = build;
     }
-    current_min = ((Spawner *)spawns[0])->getNumSpawnUnits();
-    idx = 0;
-    for (int i = 1; i < numPlayers; i++) {
+    idx = -1;
+    for (int i = 0; i < numPlayers; i++) {
+      if (spawns[i] == nullptr)
+        continue;
       int units = ((Spawner *)spawns[i])->getNumSpawnUnits();
-      if (units < current_min) {
+      if (idx < 0 || units < current_min) {
         current_min = units;
         idx = i;
       }
@@ -259,6 +217,9 @@ void Game::end(DoneStatus s) {
   case DONE_STATUS_FRAME_TIMEOUT:
     closeText = "Network error, took too long.";
     break;
+  case DONE_STATUS_MAP_MISMATCH:
+    closeText = "The players have different maps.";
+    break;
   case DONE_STATUS_BACKGROUND:
     if (gameMode == 0) {
       net->sendText("DISCONNECT");
@@ -271,12 +232,12 @@ void Game::end(DoneStatus s) {
     net->closeConnection("Normal");
   }
   panel->addText(closeText.c_str());
-  int scores[4] = {0,0,0,0};
+  std::vector<int> scores(numPlayers, 0);
   if (we_have_a_winner) {
     scores[getTeamNum(winnerSpawnID)] = 1;
   }
   std::string returnText = std::to_string(scores[0]);
-  for (int i = 1; i < remainingPlayers; i++) {
+  for (int i = 1; i < remainingPlayers && i < (int)scores.size(); i++) {
     returnText = returnText + "-" + std::to_string(scores[i]);
   }
   std::cout << returnText << std::endl;
@@ -284,12 +245,125 @@ void Game::end(DoneStatus s) {
 
 /*--------------Game state functions-------------*/
 
+void Game::placeSpawners() {
+  int p1offset = gameSize - SPAWNER_PADDING - SPAWNER_SIZE;
+  int p2offset = SPAWNER_PADDING;
+  int midoffset = (gameSize - SPAWNER_SIZE) / 2;
+  /* Corners first, then the middles of the edges */
+  int spawnerOffsets[MAX_PLAYERS][2] = {
+      {p1offset, p1offset}, {p2offset, p2offset}, {p1offset, p2offset},
+      {p2offset, p1offset}, {midoffset, p2offset}, {midoffset, p1offset},
+      {p2offset, midoffset}, {p1offset, midoffset}};
+  for (int i = 0; mapFile && i < (int)mapFile->header->numSpawners; i++) {
+    spawnerOffsets[i][0] = mapFile->header->spawners[i][0];
+    spawnerOffsets[i][1] = mapFile->header->spawners[i][1];
+  }
+  for (int i = 0; i < numPlayers; i++) {
+    buildingLists[BUILDING_TYPE_SPAWNER].push_back(
+        new Spawner(this, (SpawnerID)i, spawnerOffsets[i][0],
+                    spawnerOffsets[i][1]));
+  }
+}
+
+void Game::startMode() {
+  switch(gameMode) {
+    case 0:
+      net = new NetHandler(this, pairString, serverURI);
+      break;
+    case 1:
+      simpleAggMode();
+      break;
+    case 2:
+      simpleDefMode();
+      break;
+  }
+}
+
+/* Start a new match on the same map size, keeping the display, fonts,
+   textures and the storage of the grid. Everything else goes back to how
+   the constructor left it, except the menu toggles and colors the player
+   picked. Online games reconnect to the server for the rematch */
+void Game::reset() {
+  if (!ended)
+    end(DONE_STATUS_EXIT);
+  if (gameMode == 0) {
+    delete net;
+    net = nullptr;
+  }
+  for (auto it = agentDict.begin(); it != agentDict.end(); it++) {
+    delete it->second;
+  }
+  for (auto it = buildingLists.begin(); it != buildingLists.end(); it++) {
+    for (Building *b : it->second) {
+      delete b;
+    }
+    it->second.clear();
+  }
+  for (Objective *o : objectives) {
+    delete o;
+  }
+  agentDict.clear();
+  buildingLists.clear();
+  objectives.clear();
+  markedCoords.clear();
+  markedAgents.clear();
+  markedBuildings.clear();
+  towerZaps.clear();
+  bombEffects.clear();
+  grid.reset();
+  if (mapFile)
+    grid.loadTerrain(mapFile->cells);
+  /* The practice modes narrow numPlayers to two; go back to the size the
+     player state was made for */
+  numPlayers = numPlayerAgents.size();
+  remainingPlayers = numPlayers;
+  std::fill(numPlayerAgents.begin(), numPlayerAgents.end(), 0);
+  turnNum = 0;
+  secondsRemaining = GAME_TIME_SECONDS + STARTUP_TIME_SECONDS;
+  doneStatus = DONE_STATUS_INIT;
+  newAgentID = 1;
+  flipped_X = false;
+  flipped_Y = false;
+  resignConfirmation = false;
+  ended = false;
+  selectedObjective = nullptr;
+  selectionContext = SELECTION_CONTEXT_UNSELECTED;
+  selection = {0, 0, 1, 1};
+  placingType = BUILDING_TYPE_TOWER;
+  placementW = 0;
+  placementH = 0;
+  mouseX = 0;
+  mouseY = 0;
+  zapCounter = 1;
+  scale = initScale;
+  view = {0, 0, gameSize, gameSize};
+  selectedUnit = mapUnitAt(0, 0);
+  menu->hideAllSubMenus();
+  context = GAME_CONTEXT_CONNECTING;
+  placeSpawners();
+  panel->addText("Starting a new match.");
+  startMode();
+}
+
 void Game::checkSpawnersDestroyed() {
+  /* A spawner can only go down this tick if one of its units stopped being a
+     spawner unit */
+  bool lostSpawnerUnit = false;
+  for (CellChange &c : grid.journal) {
+    if (c.from == UNIT_TYPE_SPAWNER && grid.types[c.index] != UNIT_TYPE_SPAWNER)
+      lostSpawnerUnit = true;
+  }
+  if (!lostSpawnerUnit)
+    return;
   auto ssit = buildingLists[BUILDING_TYPE_SUBSPAWNER].begin();
   while (ssit != buildingLists[BUILDING_TYPE_SUBSPAWNER].end()) {
     if (((Subspawner *)(*ssit))->isDestroyed()) {
-      for (MapUnit::iterator m = (*ssit)->getIterator(); m.hasNext(); m++) {
-        m->building = nullptr;
+      RectView rect = (*ssit)->getView();
+      for (RowSpan r = rect.first(); r.length > 0; r = rect.next(r)) {
+        for (unsigned int i = r.start; i < r.end(); i++) {
+          grid.logChange(i);
+          grid.buildings[i] = nullptr;
+        }
       }
       delete (*ssit);
       ssit = buildingLists[BUILDING_TYPE_SUBSPAWNER].erase(ssit);
@@ -316,6 +390,7 @@ void Game::checkSpawnersDestroyed() {
           }
         }
       }
+      grid.planes[s->sid].alive = false;
       remainingPlayers--;
       if (remainingPlayers == 1) {
         for (Building *build : buildingLists[BUILDING_TYPE_SPAWNER]) {
@@ -336,14 +411,16 @@ void Game::deleteMarkedAgents() {
     if (it == agentDict.end())
       continue;
     Agent *a = it->second;
-    MapUnit *u = a->unit;
+    MapUnit u = a->unit;
     SpawnerID s = a->sid;
-    if (u->type == UNIT_TYPE_AGENT) {
-      u->type = UNIT_TYPE_EMPTY;
-    } else if (u->type == UNIT_TYPE_DOOR) {
-      u->door->isEmpty = true;
+    grid.logChange(u.index);
+    if (u.type() == UNIT_TYPE_AGENT) {
+      u.setType(UNIT_TYPE_EMPTY);
+    } else if (u.type() == UNIT_TYPE_DOOR) {
+      u.door().isEmpty = true;
+      u.refreshDoor();
     }
-    u->agent = nullptr;
+    u.agent() = nullptr;
     agentDict.erase(it);
     delete a;
     numPlayerAgents[s]--;
@@ -365,9 +442,13 @@ void Game::deleteMarkedBuildings() {
     past.push_front(build);
   }
   for (Building *build : past) {
-    for (MapUnit::iterator it = build->getIterator(); it.hasNext(); it++) {
-      it->type = UNIT_TYPE_EMPTY;
-      it->building = nullptr;
+    RectView rect = build->getView();
+    for (RowSpan r = rect.first(); r.length > 0; r = rect.next(r)) {
+      for (unsigned int i = r.start; i < r.end(); i++) {
+        grid.logChange(i);
+        grid.setType(i, UNIT_TYPE_EMPTY);
+        grid.buildings[i] = nullptr;
+      }
     }
     for (auto it = buildingLists[build->type].begin();
           it != buildingLists[build->type].end(); it++) {
@@ -394,7 +475,7 @@ void Game::receiveData(void *data, int numBytes) {
   sizeEventsBuffer(events->numAgentEvents);
   memcpy(eventsBuffer, (const void *)data, messageSize(events->numAgentEvents));
   receiveEventsBuffer();
-  if (numPlayers == 2 || turnNum == turnMap[playerSpawnID]) {
+  if (numPlayers == 2 || turnNum == getTeamNum(playerSpawnID)) {
     update();
     receiveEventsBuffer();
     sendEventsBuffer();
@@ -403,6 +484,7 @@ void Game::receiveData(void *data, int numBytes) {
 
 void Game::receiveEventsBuffer() {
   Events *events = (Events *)eventsBuffer;
+  grid.clearJournal();
   for (int i = 0; i < events->numAgentEvents; i++) {
     receiveAgentEvent(&events->agentEvents[i]);
   }
@@ -444,67 +526,76 @@ void Game::receiveAgentEvent(AgentEvent *aevent) {
   int x, y, count;
   SpawnerID s;
   Building *build;
-  MapUnit *startuptr = a->unit;
-  MapUnit *destuptr;
-  MapUnit *first;
+  MapUnit startuptr = a->unit;
+  MapUnit destuptr;
+  RectView rect(&grid, 0, 0, 0, 0);
   switch (aevent->dir) {
   case AGENT_DIRECTION_LEFT:
-    destuptr = startuptr->left;
+    destuptr = startuptr.left();
     break;
   case AGENT_DIRECTION_RIGHT:
-    destuptr = startuptr->right;
+    destuptr = startuptr.right();
     break;
   case AGENT_DIRECTION_UP:
-    destuptr = startuptr->up;
+    destuptr = startuptr.up();
     break;
   case AGENT_DIRECTION_DOWN:
-    destuptr = startuptr->down;
+    destuptr = startuptr.down();
     break;
   case AGENT_DIRECTION_STAY:
     destuptr = startuptr;
     break;
   }
+  /* Every action changes the destination unit, or marks what is on it for
+     deletion */
+  grid.logChange(destuptr.index);
   switch (aevent->action) {
   case AGENT_ACTION_MOVE:
-    if (destuptr->type == UNIT_TYPE_DOOR) destuptr->door->isEmpty = false;
-    else destuptr->type = UNIT_TYPE_AGENT;
+    grid.logChange(startuptr.index);
+    if (destuptr.type() == UNIT_TYPE_DOOR) {
+      destuptr.door().isEmpty = false;
+      destuptr.refreshDoor();
+    } else destuptr.setType(UNIT_TYPE_AGENT);
     a->unit = destuptr;
-    destuptr->agent = a;
-    if (startuptr->type == UNIT_TYPE_DOOR) startuptr->door->isEmpty = true;
-    else startuptr->type = UNIT_TYPE_EMPTY;
-    startuptr->agent = nullptr;
+    destuptr.agent() = a;
+    if (startuptr.type() == UNIT_TYPE_DOOR) {
+      startuptr.door().isEmpty = true;
+      startuptr.refreshDoor();
+    } else startuptr.setType(UNIT_TYPE_EMPTY);
+    startuptr.agent() = nullptr;
     break;
   case AGENT_ACTION_BUILDWALL:
-    destuptr->type = UNIT_TYPE_WALL;
-    destuptr->hp = STARTING_WALL_HEALTH;
+    destuptr.setType(UNIT_TYPE_WALL);
+    destuptr.hp() = STARTING_WALL_HEALTH;
     markAgentForDeletion(a->id);
     break;
   case AGENT_ACTION_BUILDDOOR:
-    if (destuptr->type == UNIT_TYPE_WALL) {
-      destuptr->type = UNIT_TYPE_DOOR;
-      destuptr->door = new Door();
-      destuptr->door->sid = a->sid;
-      destuptr->door->hp = 1;
-      destuptr->door->isEmpty = false;
+    if (destuptr.type() == UNIT_TYPE_WALL) {
+      destuptr.setType(UNIT_TYPE_DOOR);
+      destuptr.door().sid = a->sid;
+      destuptr.door().hp = 1;
+      destuptr.door().isEmpty = false;
     } else {
-      destuptr->door->hp++;
-      if (destuptr->door->hp == MAX_DOOR_HEALTH)
-        destuptr->door->isEmpty = true;
+      destuptr.door().hp++;
+      if (destuptr.door().hp == MAX_DOOR_HEALTH)
+        destuptr.door().isEmpty = true;
     }
+    destuptr.refreshDoor();
     markAgentForDeletion(a->id);
     break;
   case AGENT_ACTION_BUILDTOWER:
-    if (destuptr->type == UNIT_TYPE_EMPTY) {
-      x = destuptr->x - TOWER_SIZE / 2;
-      y = destuptr->y - TOWER_SIZE / 2;
-      first = mapUnitAt(x, y);
+    if (destuptr.type() == UNIT_TYPE_EMPTY) {
+      x = destuptr.x() - TOWER_SIZE / 2;
+      y = destuptr.y() - TOWER_SIZE / 2;
+      rect = RectView(&grid, x, y, TOWER_SIZE, TOWER_SIZE);
       count = 0;
       s = a->sid;
-      for (MapUnit::iterator it = first->getIterator(TOWER_SIZE, TOWER_SIZE);
-           it.hasNext(); it++) {
-        if (it->type == UNIT_TYPE_AGENT) {
-          markAgentForDeletion(it->agent->id);
-          count++;
+      for (RowSpan r = rect.first(); r.length > 0; r = rect.next(r)) {
+        for (unsigned int i = r.start; i < r.end(); i++) {
+          if (grid.types[i] == UNIT_TYPE_AGENT) {
+            markAgentForDeletion(grid.agents[i]->id);
+            count++;
+          }
         }
       }
       if (count > MAX_TOWER_HEALTH)
@@ -512,25 +603,26 @@ void Game::receiveAgentEvent(AgentEvent *aevent) {
       Tower *tower = new Tower(this, s, x, y);
       tower->hp = count;
       if (s == playerSpawnID)
-        destuptr->playerDict[playerSpawnID].objective->started = true;
+        destuptr.objective(playerSpawnID)->started = true;
       buildingLists[BUILDING_TYPE_TOWER].push_back(tower);
     } else {
-      destuptr->building->hp++;
+      destuptr.building()->hp++;
       markAgentForDeletion(a->id);
     }
     break;
   case AGENT_ACTION_BUILDBOMB:
-    if (destuptr->type == UNIT_TYPE_EMPTY) {
-      x = destuptr->x - BOMB_SIZE / 2;
-      y = destuptr->y - BOMB_SIZE / 2;
-      first = mapUnitAt(x, y);
+    if (destuptr.type() == UNIT_TYPE_EMPTY) {
+      x = destuptr.x() - BOMB_SIZE / 2;
+      y = destuptr.y() - BOMB_SIZE / 2;
+      rect = RectView(&grid, x, y, BOMB_SIZE, BOMB_SIZE);
       count = 0;
       s = a->sid;
-      for (MapUnit::iterator it = first->getIterator(BOMB_SIZE, BOMB_SIZE);
-           it.hasNext(); it++) {
-        if (it->type == UNIT_TYPE_AGENT) {
-          markAgentForDeletion(it->agent->id);
-          count++;
+      for (RowSpan r = rect.first(); r.length > 0; r = rect.next(r)) {
+        for (unsigned int i = r.start; i < r.end(); i++) {
+          if (grid.types[i] == UNIT_TYPE_AGENT) {
+            markAgentForDeletion(grid.agents[i]->id);
+            count++;
+          }
         }
       }
       if (count > MAX_BOMB_HEALTH)
@@ -538,60 +630,60 @@ void Game::receiveAgentEvent(AgentEvent *aevent) {
       Bomb *bomb = new Bomb(this, s, x, y);
       bomb->hp = count;
       if (s == playerSpawnID)
-        destuptr->playerDict[playerSpawnID].objective->started = true;
+        destuptr.objective(playerSpawnID)->started = true;
       buildingLists[BUILDING_TYPE_BOMB].push_back(bomb);
     } else {
-      destuptr->building->hp++;
+      destuptr.building()->hp++;
       markAgentForDeletion(a->id);
     }
     break;
   case AGENT_ACTION_BUILDSUBSPAWNER:
-    if (destuptr->type == UNIT_TYPE_EMPTY) {
-      destuptr->hp = 1;
-      destuptr->type = UNIT_TYPE_SPAWNER;
-      if (destuptr->building == nullptr) {
+    if (destuptr.type() == UNIT_TYPE_EMPTY) {
+      destuptr.hp() = 1;
+      destuptr.setType(UNIT_TYPE_SPAWNER);
+      if (destuptr.building() == nullptr) {
         Subspawner *subspawner =
-            new Subspawner(this, a->sid, destuptr->x - SUBSPAWNER_SIZE / 2,
-                           destuptr->y - SUBSPAWNER_SIZE / 2);
+            new Subspawner(this, a->sid, destuptr.x() - SUBSPAWNER_SIZE / 2,
+                           destuptr.y() - SUBSPAWNER_SIZE / 2);
         if (a->sid == playerSpawnID)
-          destuptr->playerDict[playerSpawnID].objective->started = true;
+          destuptr.objective(playerSpawnID)->started = true;
         buildingLists[BUILDING_TYPE_SUBSPAWNER].push_back(subspawner);
       }
     } else {
-      destuptr->hp++;
+      destuptr.hp()++;
     }
     markAgentForDeletion(a->id);
     break;
   case AGENT_ACTION_ATTACK:
-    switch (destuptr->type) {
+    switch (destuptr.type()) {
     case UNIT_TYPE_SPAWNER:
-      destuptr->type = UNIT_TYPE_EMPTY;
+      destuptr.setType(UNIT_TYPE_EMPTY);
       markAgentForDeletion(a->id);
       break;
     case UNIT_TYPE_AGENT:
-      markAgentForDeletion(destuptr->agent->id);
+      markAgentForDeletion(destuptr.agent()->id);
       markAgentForDeletion(a->id);
       break;
     case UNIT_TYPE_WALL:
-      destuptr->hp--;
-      if (destuptr->hp == 0)
-        destuptr->type = UNIT_TYPE_EMPTY;
+      destuptr.hp()--;
+      if (destuptr.hp() == 0)
+        destuptr.setType(UNIT_TYPE_EMPTY);
       markAgentForDeletion(a->id);
       break;
     case UNIT_TYPE_DOOR:
-      destuptr->door->hp--;
-      if (destuptr->door->hp == 0) {
-        delete destuptr->door;
-        if (destuptr->agent != nullptr) {
-          destuptr->type = UNIT_TYPE_AGENT;
+      destuptr.door().hp--;
+      destuptr.refreshDoor();
+      if (destuptr.door().hp == 0) {
+        if (destuptr.agent() != nullptr) {
+          destuptr.setType(UNIT_TYPE_AGENT);
         } else {
-          destuptr->type = UNIT_TYPE_EMPTY;
+          destuptr.setType(UNIT_TYPE_EMPTY);
         }
       }
       markAgentForDeletion(a->id);
       break;
     case UNIT_TYPE_BUILDING:
-      build = destuptr->building;
+      build = destuptr.building();
       build->hp--;
       if (build->hp <= 0) markBuildingForDeletion(build);
       markAgentForDeletion(a->id);
@@ -609,7 +701,7 @@ void Game::receiveTowerEvent(TowerEvent *tevent) {
     auto it = agentDict.find(tevent->id);
     if (it != agentDict.end()) {
       Agent *a = it->second;
-      TowerZap t = {tevent->x, tevent->y, (int)a->unit->x, (int)a->unit->y, std::chrono::high_resolution_clock::now()};
+      TowerZap t = {tevent->x, tevent->y, (int)a->unit.x(), (int)a->unit.y(), std::chrono::high_resolution_clock::now()};
       towerZaps.push_back(t);
       markAgentForDeletion(a->id);
     }
@@ -618,11 +710,11 @@ void Game::receiveTowerEvent(TowerEvent *tevent) {
 
 void Game::receiveSpawnerEvent(SpawnerEvent *sevent) {
   if (sevent->created) {
-    MapUnit *uptr = mapUnitAt(sevent->x, sevent->y);
+    MapUnit uptr = mapUnitAt(sevent->x, sevent->y);
     Agent *a = new Agent(this, uptr, sevent->id, sevent->sid);
     agentDict.insert(std::make_pair(sevent->id, a));
-    uptr->agent = a;
-    uptr->type = UNIT_TYPE_AGENT;
+    uptr.agent() = a;
+    uptr.setType(UNIT_TYPE_AGENT);
     if (sevent->id >= newAgentID)
       newAgentID = sevent->id + 1;
     numPlayerAgents[sevent->sid]++;
@@ -639,46 +731,47 @@ void Game::receiveBombEvent(BombEvent *bevent) {
       startx = 0;
     if (starty < 0)
       starty = 0;
-    MapUnit *first = mapUnitAt(startx, starty);
-    for (MapUnit::iterator m =
-             first->getIterator(BOMB_AOE_RADIUS * 2, BOMB_AOE_RADIUS * 2);
-         m.hasNext(); m++) {
-      int dx = m->x - bevent->x;
-      int dy = m->y - bevent->y;
-      if (dx * dx + dy * dy <= BOMB_AOE_RADIUS * BOMB_AOE_RADIUS) {
-        switch (m->type) {
+    RectView rect(&grid, startx, starty, BOMB_AOE_RADIUS * 2,
+                  BOMB_AOE_RADIUS * 2);
+    for (RowSpan r = rect.first(); r.length > 0; r = rect.next(r)) {
+      int dy = r.y - bevent->y;
+      for (int j = 0; j < r.length; j++) {
+        int dx = r.x + j - bevent->x;
+        if (dx * dx + dy * dy > BOMB_AOE_RADIUS * BOMB_AOE_RADIUS)
+          continue;
+        unsigned int i = r.start + j;
+        switch (grid.types[i]) {
         case UNIT_TYPE_AGENT:
-          markAgentForDeletion(m->agent->id);
+          markAgentForDeletion(grid.agents[i]->id);
           break;
         case UNIT_TYPE_SPAWNER:
           break;
         case UNIT_TYPE_DOOR:
-          delete m->door;
-          m->door = nullptr;
-          if (m->agent != nullptr) {
-            markAgentForDeletion(m->agent->id);
+          if (grid.agents[i] != nullptr) {
+            markAgentForDeletion(grid.agents[i]->id);
           }
           break;
         case UNIT_TYPE_BUILDING:
-          markBuildingForDeletion(m->building);
+          markBuildingForDeletion(grid.buildings[i]);
           break;
         default:
           break;
         }
-        m->type = UNIT_TYPE_EMPTY;
+        grid.setType(i, UNIT_TYPE_EMPTY);
       }
     }
   }
 }
 
-void Game::update() {
+/* Run one tick for playerSpawnID. Pass false for diffuse when the player's
+   scent was already diffused this tick along with the other local players */
+void Game::update(bool diffuse) {
   sizeEventsBuffer(numPlayerAgents[playerSpawnID]);
   Events *events = (Events *)eventsBuffer;
-  for (MapUnit *u : mapUnits) {
-    u->marked = false;
-    u->update();
-    u->playerDict[playerSpawnID].objective = nullptr;
-  }
+  grid.clearMarks();
+  grid.clearObjectives(playerSpawnID);
+  if (diffuse)
+    grid.diffuse(playerSpawnID);
   auto it = objectives.begin();
   while (it != objectives.end()) {
     if (!((*it)->sid == playerSpawnID)) {
@@ -710,6 +803,8 @@ void Game::update() {
   int bombI = 0;
   int towerI = 0;
   int subspawnerI = 1;
+  /* Spawners wait while the player has MAX_AGENTS_PER_PLAYER agents */
+  int agentRoom = MAX_AGENTS_PER_PLAYER - numPlayerAgents[playerSpawnID];
   for (auto it = buildingLists.begin(); it != buildingLists.end(); it++) {
     for (Building *build : it->second) {
       if (build->sid == playerSpawnID) {
@@ -723,11 +818,19 @@ void Game::update() {
           towerI++;
           break;
         case BUILDING_TYPE_SUBSPAWNER:
-          ((Subspawner *)build)->update(&events->spawnEvents[subspawnerI]);
+          if (agentRoom > 0) {
+            ((Subspawner *)build)->update(&events->spawnEvents[subspawnerI]);
+            if (events->spawnEvents[subspawnerI].created)
+              agentRoom--;
+          }
           subspawnerI++;
           break;
         case BUILDING_TYPE_SPAWNER:
-          ((Spawner *)build)->update(&events->spawnEvents[0]);
+          if (agentRoom > 0) {
+            ((Spawner *)build)->update(&events->spawnEvents[0]);
+            if (events->spawnEvents[0].created)
+              agentRoom--;
+          }
         }
       }
     }
@@ -771,8 +874,10 @@ void Game::simpleDefMode() {
 /*------------------Objective Functions-----------------*/
 
 void Game::clearScent() {
-  for (auto it = getSelectionIterator(); it.hasNext(); it++) {
-    it->clearScent();
+  RectView rect = getSelectionView();
+  for (RowSpan r = rect.first(); r.length > 0; r = rect.next(r)) {
+    for (unsigned int i = r.start; i < r.end(); i++)
+      grid.unitAt(i).clearScent();
   }
 }
 
@@ -857,12 +962,10 @@ void Game::deleteSelectedObjective() {
           break;
         }
       }
-      MapUnit *first =
-          mapUnitAt(selectedObjective->region.x, selectedObjective->region.y);
-      for (MapUnit::iterator it = first->getIterator(
-               selectedObjective->region.w, selectedObjective->region.h);
-           it.hasNext(); it++) {
-        it->playerDict[playerSpawnID].objective = nullptr;
+      RectView rect = selectedObjective->getView();
+      for (RowSpan r = rect.first(); r.length > 0; r = rect.next(r)) {
+        for (unsigned int i = r.start; i < r.end(); i++)
+          grid.unitAt(i).setObjective(playerSpawnID, nullptr);
       }
       delete selectedObjective;
       selectedObjective = nullptr;
@@ -940,7 +1043,8 @@ void Game::pinkBrown() {
 }
 
 void Game::zoomIn() {
-  if (scale == MAX_SCALE)
+  /* A map can make the starting scale fractional */
+  if (scale + 1.0 > MAX_SCALE)
     return;
   scale += 1.0;
   adjustViewToScale();
@@ -956,8 +1060,8 @@ void Game::zoomOut() {
 void Game::adjustViewToScale() {
   view.w = (int)((double)gameDisplaySize / scale);
   view.h = (int)((double)gameDisplaySize / scale);
-  view.x = selectedUnit->x - view.w / 2;
-  view.y = selectedUnit->y - view.h / 2;
+  view.x = selectedUnit.x() - view.w / 2;
+  view.y = selectedUnit.y() - view.h / 2;
   if (view.x < 0)
     view.x = 0;
   if (view.y < 0)
@@ -1031,17 +1135,17 @@ void Game::mouseMoved(int x, int y) {
     }
     break;
   case SELECTION_CONTEXT_SELECTING:
-    if (mouseUnitX > (int)selectedUnit->x) {
-      potW = mouseUnitX - selectedUnit->x + 1;
+    if (mouseUnitX > (int)selectedUnit.x()) {
+      potW = mouseUnitX - selectedUnit.x() + 1;
     } else {
       potX = mouseUnitX;
-      potW = selectedUnit->x - mouseUnitX;
+      potW = selectedUnit.x() - mouseUnitX;
     }
-    if (mouseUnitY > (int)selectedUnit->y) {
-      potH = mouseUnitY - selectedUnit->y + 1;
+    if (mouseUnitY > (int)selectedUnit.y()) {
+      potH = mouseUnitY - selectedUnit.y() + 1;
     } else {
       potY = mouseUnitY;
-      potH = selectedUnit->y - mouseUnitY;
+      potH = selectedUnit.y() - mouseUnitY;
     }
     if (potW <= 0)
       potW = 1;
@@ -1223,6 +1327,8 @@ void Game::panViewTrueDown() {
 /*----------------Display Functions------------------*/
 
 void Game::setColors(int pn, std::string nm, int r, int g, int b) {
+  if (pn >= (int)colorScheme.size())
+    return;
   colorScheme[pn].name = nm;
   colorScheme[pn].r = r;
   colorScheme[pn].g = g;
@@ -1370,64 +1476,66 @@ void Game::draw() {
   disp->drawRectFilled(0, panelYDrawOffset, gameDisplaySize, gameDisplaySize);
   int lum;
   double lumprop;
-  MapUnit *first = mapUnitAt(view.x, view.y);
-  for (MapUnit::iterator iter = first->getIterator(view.w, view.h);
-       iter.hasNext(); iter++) {
-    int scaledX = scaleInt(iter->x - view.x);
-    int scaledY = scaleInt(iter->y - view.y) + panelYDrawOffset;
-    flipIfNeeded(&scaledX, &scaledY, (int)scale, (int)scale);
-    int off;
-    double offProp;
-    switch (iter->type) {
-    case UNIT_TYPE_AGENT:
-      setTeamDrawColor(iter->agent->sid);
-      disp->drawRectFilled(scaledX, scaledY, (int)scale, (int)scale);
-      break;
-    case UNIT_TYPE_BUILDING:
-      break;
-    case UNIT_TYPE_DOOR:
-      setTeamDrawColor(iter->door->sid);
-      disp->drawRectFilled(scaledX, scaledY, (int)scale, (int)scale);
-      if (iter->door->hp < MAX_DOOR_HEALTH || iter->door->isEmpty) {
+  RectView rect(&grid, view.x, view.y, view.w, view.h);
+  for (RowSpan r = rect.first(); r.length > 0; r = rect.next(r)) {
+    for (unsigned int i = r.start; i < r.end(); i++) {
+      MapUnit iter = grid.unitAt(i);
+      int scaledX = scaleInt(iter.x() - view.x);
+      int scaledY = scaleInt(iter.y() - view.y) + panelYDrawOffset;
+      flipIfNeeded(&scaledX, &scaledY, (int)scale, (int)scale);
+      int off;
+      double offProp;
+      switch (iter.type()) {
+      case UNIT_TYPE_AGENT:
+        setTeamDrawColor(iter.agent()->sid);
+        disp->drawRectFilled(scaledX, scaledY, (int)scale, (int)scale);
+        break;
+      case UNIT_TYPE_BUILDING:
+        break;
+      case UNIT_TYPE_DOOR:
+        setTeamDrawColor(iter.door().sid);
+        disp->drawRectFilled(scaledX, scaledY, (int)scale, (int)scale);
+        if (iter.door().hp < MAX_DOOR_HEALTH || iter.door().isEmpty) {
+          if (menu->getIfScentsShown()) {
+            lum = (int)(255.0 * fromScent(iter.scent(playerSpawnID)) /
+                        255.0);
+            disp->setDrawColor(lum, 0, lum);
+          } else {
+            disp->setDrawColorBlack();
+          }
+          offProp = (double)iter.door().hp / (double)MAX_DOOR_HEALTH;
+          off = (int)(offProp * scale * 1.0 / 4.0);
+          disp->drawRectFilled(scaledX + (int)(scale / 2.0) - off,
+                               scaledY + (int)(scale / 2.0) - off, 2 * off,
+                               2 * off);
+        }
+        break;
+      case UNIT_TYPE_SPAWNER:
+        setTeamDrawColor(iter.building()->sid);
+        lumprop = (double)iter.hp() / (double)SUBSPAWNER_UNIT_COST;
+        disp->setDrawColorBrightness(lumprop);
+        if (((iter.x() + iter.y()) % 2) == 0)
+          disp->setDrawColorBrightness(0.5);
+        disp->drawRectFilled(scaledX, scaledY, (int)scale, (int)scale);
+        break;
+      case UNIT_TYPE_WALL:
+        lum = (int)(((double)iter.hp() / (double)MAX_WALL_HEALTH) * 100.0) + 155;
+        disp->setDrawColor(lum, lum, lum);
+        disp->drawRectFilled(scaledX, scaledY, (int)scale, (int)scale);
+        break;
+      case UNIT_TYPE_EMPTY:
         if (menu->getIfScentsShown()) {
-          lum = (int)(255.0 * (double)iter->playerDict[playerSpawnID].scent /
+          lum = (int)(255.0 * fromScent(iter.scent(playerSpawnID)) /
                       255.0);
           disp->setDrawColor(lum, 0, lum);
         } else {
           disp->setDrawColorBlack();
         }
-        offProp = (double)iter->door->hp / (double)MAX_DOOR_HEALTH;
-        off = (int)(offProp * scale * 1.0 / 4.0);
-        disp->drawRectFilled(scaledX + (int)(scale / 2.0) - off,
-                             scaledY + (int)(scale / 2.0) - off, 2 * off,
-                             2 * off);
-      }
-      break;
-    case UNIT_TYPE_SPAWNER:
-      setTeamDrawColor(iter->building->sid);
-      lumprop = (double)iter->hp / (double)SUBSPAWNER_UNIT_COST;
-      disp->setDrawColorBrightness(lumprop);
-      if (((iter->x + iter->y) % 2) == 0)
-        disp->setDrawColorBrightness(0.5);
-      disp->drawRectFilled(scaledX, scaledY, (int)scale, (int)scale);
-      break;
-    case UNIT_TYPE_WALL:
-      lum = (int)(((double)iter->hp / (double)MAX_WALL_HEALTH) * 100.0) + 155;
-      disp->setDrawColor(lum, lum, lum);
-      disp->drawRectFilled(scaledX, scaledY, (int)scale, (int)scale);
-      break;
-    case UNIT_TYPE_EMPTY:
-      if (menu->getIfScentsShown()) {
-        lum = (int)(255.0 * (double)iter->playerDict[playerSpawnID].scent /
-                    255.0);
-        disp->setDrawColor(lum, 0, lum);
-      } else {
-        disp->setDrawColorBlack();
+        disp->drawRectFilled(scaledX, scaledY, (int)scale, (int)scale);
+        break;
+      default:
+        break;
       }
-      disp->drawRectFilled(scaledX, scaledY, (int)scale, (int)scale);
-      break;
-    default:
-      break;
     }
   }
   drawEffects();
@@ -1561,22 +1669,7 @@ bool Game::potentialSelectionCollidesWithObjective(int potX, int potY, int potW,
   return false;
 }
 
-int Game::getTeamNum(SpawnerID sid) {
-  switch (sid) {
-  case SPAWNER_ID_ONE:
-    return 0;
-    break;
-  case SPAWNER_ID_TWO:
-    return 1;
-    break;
-  case SPAWNER_ID_THREE:
-    return 2;
-    break;
-  case SPAWNER_ID_FOUR:
-    return 3;
-    break;
-  }
-}
+int Game::getTeamNum(SpawnerID sid) { return (int)sid; }
 
 int Game::scaleInt(int toScale) { return (int)(scale * ((double)toScale)); }
 int Game::getSize() { return gameSize; }
@@ -1596,10 +1689,10 @@ void Game::showCosts() { panel->costsText(); }
 void Game::clearPanel() { panel->clearText(); }
 void Game::markAgentForDeletion(AgentID id) { markedAgents.push_back(id); }
 void Game::markBuildingForDeletion(Building *build) { markedBuildings.push_back(build); }
-MapUnit *Game::mapUnitAt(int x, int y) { return mapUnits[y * gameSize + x]; }
-MapUnit::iterator Game::getSelectionIterator() {
-  return mapUnitAt(selection.x + view.x, selection.y + view.y)
-      ->getIterator(selection.w, selection.h);
+MapUnit Game::mapUnitAt(int x, int y) { return grid.unitAt(x, y); }
+RectView Game::getSelectionView() {
+  return RectView(&grid, selection.x + view.x, selection.y + view.y,
+                  selection.w, selection.h);
 }
 
 /*----------------------Main event loop------------------------*/
@@ -1775,11 +1868,18 @@ void Game::handleSDLEvent(SDL_Event *e) {
     case SDLK_DELETE:
       deleteSelectedObjective();
       break;
+    case SDLK_r:
+      if (context == GAME_CONTEXT_DONE)
+        reset();
+      break;
     }
     break;
   }
 }
 
+/* The players a practice game simulates, in the order they update */
+static const SpawnerID practicePlayers[] = {SPAWNER_ID_TWO, SPAWNER_ID_ONE};
+
 void Game::mainLoop(void) {
   pthread_mutex_lock(&threadLock);
   switch (context) {
@@ -1798,11 +1898,22 @@ void Game::mainLoop(void) {
     drawStartupScreen();
     break;
   case GAME_CONTEXT_PRACTICE:
+    /* Both players are simulated here, so their scent is diffused in one
+       pass over the map. ONE's scent is meant to be diffused after TWO's
+       turn, so the units changed since the pass are diffused again before
+       ONE moves. Red black sweeps can't be patched that way, so in that mode
+       each player is diffused on its own turn */
+    bool fused;
+    fused = grid.diffusionMode != DIFFUSION_MODE_RED_BLACK;
+    if (fused)
+      grid.diffuse(practicePlayers, 2);
     playerSpawnID = SPAWNER_ID_TWO;
-    update();
+    update(!fused);
     receiveEventsBuffer();
+    if (fused)
+      grid.rediffuseChanges(SPAWNER_ID_ONE);
     playerSpawnID = SPAWNER_ID_ONE;
-    update();
+    update(!fused);
     receiveEventsBuffer();
     std::this_thread::sleep_for(std::chrono::milliseconds(50));
   default:
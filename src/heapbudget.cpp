@@ -0,0 +1,35 @@
+#include "heapbudget.h"
+
+#include <map>
+
+#include "agent.h"
+#include "constants.h"
+#include "event.h"
+#include "mapgrid.h"
+
+/* Bytes of a red-black tree node: the value plus three links and a color */
+const size_t MAP_NODE_BYTES = sizeof(std::pair<const AgentID, Agent *>) +
+                              4 * sizeof(void *);
+
+size_t HeapBudget::total() {
+  return gridBytes + agentBytes + eventBytes + objectiveBytes + dictBytes;
+}
+
+HeapBudget planHeap(MapGrid &grid) {
+  HeapBudget b;
+  size_t players = grid.planes.size();
+  b.agentCap = (size_t)MAX_AGENTS_PER_PLAYER * players;
+  if (b.agentCap > (size_t)grid.size * grid.size)
+    b.agentCap = (size_t)grid.size * grid.size;
+  b.eventCap = (b.agentCap < (size_t)MAX_AGENTS_PER_PLAYER)
+                   ? b.agentCap
+                   : (size_t)MAX_AGENTS_PER_PLAYER;
+  b.objectiveCap = (size_t)OBJECTIVES_PER_PLAYER * players;
+  b.nodeBytes = MAP_NODE_BYTES;
+  b.gridBytes = grid.heapBytes();
+  b.agentBytes = b.agentCap * sizeof(Agent);
+  b.eventBytes = sizeof(Events) + b.eventCap * sizeof(AgentEvent);
+  b.objectiveBytes = b.objectiveCap * OBJECTIVE_BYTES;
+  b.dictBytes = b.agentCap * b.nodeBytes;
+  return b;
+}
@@ -1,5 +1,7 @@
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <iostream>
 
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
@@ -9,6 +11,7 @@
 
 #include "display.h"
 #include "game.h"
+#include "mapfile.h"
 
 void mainloop(void *arg) {
   Game *g = (Game *)arg;
@@ -46,9 +49,37 @@ int main(int argc, char *argv[]) {
   int gameSize = atoi(argv[1]);
   int gamePanelSize = atoi(argv[2]);
   double gameInitScale = atof(argv[3]);
-  bool mobile = (argc > 8);
+  /* Past the seventh argument, MAP_ARGUMENT followed by a path loads a map
+     file, and anything else asks for the mobile layout */
+  bool mobile = false;
+  const char *mapPath = nullptr;
+  for (int i = 8; i < argc; i++) {
+    if (strncmp(argv[i], MAP_ARGUMENT, strlen(MAP_ARGUMENT)) == 0)
+      mapPath = argv[i] + strlen(MAP_ARGUMENT);
+    else
+      mobile = true;
+  }
+  /* The map sets the size of the game; the scale changes with it so the
+     display stays the size it was asked for */
+  MapFile *mapFile = nullptr;
+  if (mapPath) {
+    mapFile = new MapFile(mapPath);
+    /* Game plays at least two and at most MAX_PLAYERS players */
+    int players = (numPlayers < 2) ? 2 : numPlayers;
+    if (players > MAX_PLAYERS)
+      players = MAX_PLAYERS;
+    if (mapFile->isValid(players)) {
+      gameInitScale = gameInitScale * gameSize / mapFile->header->size;
+      gameSize = mapFile->header->size;
+    } else {
+      std::cout << mapPath << " is not a valid map for " << players
+                << " players" << std::endl;
+      delete mapFile;
+      mapFile = nullptr;
+    }
+  }
   Game *g = new Game(gameMode, gameSize, gamePanelSize, gameInitScale, argv[4],
-                     argv[5], numPlayers, mobile);
+                     argv[5], numPlayers, mobile, mapFile);
 
   SDL_SetEventFilter(handleAppEvents, (void *)g);
 
@@ -63,5 +94,6 @@ int main(int argc, char *argv[]) {
 #endif
 
   delete g;
+  delete mapFile;
   return 0;
 }
@@ -0,0 +1,89 @@
+#include "mapfile.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iostream>
+
+MapFile::MapFile(const char *path)
+    : data(nullptr), length(0), header(nullptr), cells(nullptr) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    std::cout << "Could not open map " << path << std::endl;
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(MapFileHeader)) {
+    length = st.st_size;
+    data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+      data = nullptr;
+  }
+  close(fd);
+  if (data == nullptr) {
+    std::cout << "Could not map " << path << std::endl;
+    return;
+  }
+  header = (MapFileHeader *)data;
+  cells = (const unsigned char *)data + sizeof(MapFileHeader);
+}
+
+MapFile::~MapFile() {
+  if (data != nullptr)
+    munmap(data, length);
+}
+
+/* Whether the file is a map a match of the given number of players can be
+   played on: the map is no bigger than MAP_FILE_MAX_SIZE, every spawner fits
+   on it, the spawners the players start at don't overlap, and every cell is
+   empty, a wall or a door owned by one of the players */
+bool MapFile::isValid(int players) {
+  if (header == nullptr)
+    return false;
+  if (memcmp(header->magic, MAP_FILE_MAGIC, sizeof(MAP_FILE_MAGIC)) != 0 ||
+      header->version != MAP_FILE_VERSION ||
+      header->size < (uint32_t)SPAWNER_SIZE ||
+      header->size > (uint32_t)MAP_FILE_MAX_SIZE ||
+      header->numSpawners > MAX_PLAYERS ||
+      header->numSpawners < (uint32_t)players)
+    return false;
+  size_t units = (size_t)header->size * header->size;
+  if (length - sizeof(MapFileHeader) < units)
+    return false;
+  int64_t most = (int64_t)header->size - SPAWNER_SIZE;
+  for (uint32_t i = 0; i < header->numSpawners; i++) {
+    for (int k = 0; k < 2; k++) {
+      if (header->spawners[i][k] < 0 || header->spawners[i][k] > most)
+        return false;
+    }
+  }
+  for (int i = 0; i < players; i++) {
+    for (int j = i + 1; j < players; j++) {
+      int64_t dx = (int64_t)header->spawners[i][0] - header->spawners[j][0];
+      int64_t dy = (int64_t)header->spawners[i][1] - header->spawners[j][1];
+      if (dx < SPAWNER_SIZE && dx > -SPAWNER_SIZE && dy < SPAWNER_SIZE &&
+          dy > -SPAWNER_SIZE)
+        return false;
+    }
+  }
+  for (size_t i = 0; i < units; i++) {
+    if (cells[i] >= MAP_CELL_DOOR + players)
+      return false;
+  }
+  return true;
+}
+
+/* 64 bit FNV-1a hash of the whole file, which online players exchange to
+   check that they are playing on the same map */
+uint64_t MapFile::hash() {
+  uint64_t h = 14695981039346656037ull;
+  const unsigned char *bytes = (const unsigned char *)data;
+  for (size_t i = 0; i < length; i++) {
+    h ^= bytes[i];
+    h *= 1099511628211ull;
+  }
+  return h;
+}
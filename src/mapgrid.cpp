@@ -0,0 +1,904 @@
+#include "mapgrid.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "constants.h"
+#include "diffusepool.h"
+#include "mapfile.h"
+#include "mapunit.h"
+
+RectCounter::RectCounter(int n, bool full): size(n), tree((n + 1) * (n + 1), 0) {
+  reset(full);
+}
+
+/* All units are counted when full is set, none otherwise; node (i, j) of a
+   full tree covers (i & -i) * (j & -j) units */
+void RectCounter::reset(bool full) {
+  std::fill(tree.begin(), tree.end(), 0);
+  if (full) {
+    for (int i = 1; i <= size; i++) {
+      for (int j = 1; j <= size; j++)
+        tree[i * (size + 1) + j] = (i & -i) * (j & -j);
+    }
+  }
+}
+
+/* Turn a tree holding the count of each unit at node (y + 1, x + 1) into a
+   Fenwick tree in linear time, one dimension after the other */
+void RectCounter::build() {
+  int n = size + 1;
+  for (int i = 1; i <= size; i++) {
+    for (int j = 1; j <= size; j++) {
+      int p = j + (j & -j);
+      if (p <= size)
+        tree[i * n + p] += tree[i * n + j];
+    }
+  }
+  for (int i = 1; i <= size; i++) {
+    int p = i + (i & -i);
+    if (p > size)
+      continue;
+    for (int j = 1; j <= size; j++)
+      tree[p * n + j] += tree[i * n + j];
+  }
+}
+
+void RectCounter::add(int x, int y, int delta) {
+  for (int i = y + 1; i <= size; i += i & -i) {
+    for (int j = x + 1; j <= size; j += j & -j)
+      tree[i * (size + 1) + j] += delta;
+  }
+}
+
+/* Number of counted units with x' < x and y' < y */
+int RectCounter::prefix(int x, int y) {
+  int total = 0;
+  for (int i = y; i > 0; i -= i & -i) {
+    for (int j = x; j > 0; j -= j & -j)
+      total += tree[i * (size + 1) + j];
+  }
+  return total;
+}
+
+int RectCounter::count(int x, int y, int w, int h) {
+  return prefix(x + w, y + h) - prefix(x, y + h) - prefix(x + w, y) +
+         prefix(x, y);
+}
+
+ScentPlane::ScentPlane(unsigned int n, unsigned int chunks)
+    : alive(true), epoch(1), objectives(n, nullptr), objectiveEpochs(n, 0), scent(n, 0.0),
+      prevScent(n, 0.0), chunkMax(chunks, 0.0),
+      chunkAwake(chunks, false), chunkActive(chunks, false), sources(n),
+      changed(n), nextAwake(chunks, false), levelBlocked(n) {
+  /* The lists never hold a chunk or unit twice, so they never grow past
+     this */
+  awakeChunks.reserve(chunks);
+  touchedChunks.reserve(chunks);
+  activeChunks.reserve(chunks);
+  sourceList.reserve(n);
+  changedList.reserve(n);
+  hotChunks.reserve(chunks);
+  nextAwakeChunks.reserve(chunks);
+}
+
+void ScentPlane::reset() {
+  alive = true;
+  epoch = 1;
+  std::fill(objectives.begin(), objectives.end(), nullptr);
+  std::fill(objectiveEpochs.begin(), objectiveEpochs.end(), 0);
+  std::fill(scent.begin(), scent.end(), 0.0);
+  std::fill(prevScent.begin(), prevScent.end(), 0.0);
+  std::fill(chunkMax.begin(), chunkMax.end(), 0.0);
+  std::fill(chunkAwake.begin(), chunkAwake.end(), false);
+  awakeChunks.clear();
+  touchedChunks.clear();
+  std::fill(chunkActive.begin(), chunkActive.end(), false);
+  activeChunks.clear();
+  std::fill(sources.words.begin(), sources.words.end(), 0);
+  sourceList.clear();
+  clearChanged();
+  for (ScentLevel &level : levels) {
+    level.reset();
+  }
+  std::fill(levelBlocked.words.begin(), levelBlocked.words.end(), 0);
+}
+
+void ScentPlane::clearChanged() {
+  for (unsigned int i : changedList) {
+    changed.clear(i);
+  }
+  changedList.clear();
+}
+
+ScentLevel::ScentLevel(int mapSize, int f)
+    : factor(f), size((mapSize + f - 1) / f), stride(size + 2), most(0.0),
+      scent(stride * stride, 0), next(stride * stride, 0),
+      coeff(stride * stride, 0), blocked(stride * stride, 0) {
+  reset();
+}
+
+/* Back to an open map with no scent */
+void ScentLevel::reset() {
+  most = 0.0;
+  std::fill(scent.begin(), scent.end(), 0);
+  std::fill(next.begin(), next.end(), 0);
+  std::fill(blocked.begin(), blocked.end(), 0);
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++)
+      coeff[(y + 1) * stride + x + 1] = SCENT_COEFF;
+  }
+}
+
+/* Scent s was put on the unit at x, y */
+void ScentLevel::touch(int x, int y, double s) {
+  int c = cellOf(x, y);
+  Scent v = toScent(s);
+  if (v > scent[c])
+    scent[c] = v;
+  if (s > most)
+    most = s;
+}
+
+/* The unit at x, y started (d = 1) or stopped (d = -1) keeping scent out;
+   its cell passes scent on only while none of its units do */
+void ScentLevel::block(int x, int y, int d) {
+  int c = cellOf(x, y);
+  blocked[c] += d;
+  coeff[c] = blocked[c] ? 0 : SCENT_COEFF;
+}
+
+/* One Jacobi pass over the level with the grid's row stencil; a level with
+   no scent left is skipped */
+void ScentLevel::diffuse(StencilRow row) {
+  if (most <= SCENT_EPSILON)
+    return;
+  double m = 0.0;
+  for (int j = 1; j <= size; j++) {
+    int start = j * stride + 1;
+    double rowMost =
+        row(next.data() + start, scent.data() + start - 1,
+            scent.data() + start - stride, scent.data() + start + 1,
+            scent.data() + start + stride, coeff.data() + start, size);
+    if (rowMost > m)
+      m = rowMost;
+  }
+  scent.swap(next);
+  most = m;
+}
+
+/* Number of units the arrays need to hold a padded map of the given stride */
+static unsigned int layoutUnits(GridLayout layout, unsigned int stride,
+                                unsigned int tileShift) {
+  unsigned int tiles, side;
+  switch (layout) {
+  case GRID_LAYOUT_TILED_8:
+  case GRID_LAYOUT_TILED_16:
+    tiles = (stride + (1u << tileShift) - 1) >> tileShift;
+    return (tiles * tiles) << (2 * tileShift);
+  case GRID_LAYOUT_MORTON:
+    side = 1;
+    while (side < stride)
+      side <<= 1;
+    return side * side;
+  default:
+    return stride * stride;
+  }
+}
+
+MapGrid::MapGrid(Game *g, int sz, int players, GridLayout l, int threads)
+    : game(g), layout(l), size(sz), stride(sz + 2),
+      tileShift((l == GRID_LAYOUT_TILED_16) ? 4 : 3),
+      tilesPerRow((stride + (1u << tileShift) - 1) >> tileShift),
+      numUnits(layoutUnits(l, stride, tileShift)),
+      chunksPerRow((sz + SCENT_CHUNK_SIZE - 1) / SCENT_CHUNK_SIZE),
+      types(numUnits, UNIT_TYPE_OUTSIDE), hps(numUnits, 0),
+      agents(numUnits, nullptr), buildings(numUnits, nullptr),
+      doors(numUnits, {SPAWNER_ID_ONE, 0, false}), markEpoch(1),
+      marks(numUnits, 0),
+      occupancy(UNIT_TYPE_OUTSIDE + 1, BitPlane(numUnits)),
+      diffusion(numUnits, 0), journaled(numUnits), relaxation(DEFAULT_RELAXATION),
+      relaxationSweeps(DEFAULT_RELAXATION_SWEEPS),
+      stencilRow(stencilRowFor(bestStencilISA())), diffusePool(nullptr) {
+  if (threads <= 0)
+    threads = std::thread::hardware_concurrency();
+  /* Each thread needs a chunk row of its own */
+  if (threads > (int)chunksPerRow)
+    threads = chunksPerRow;
+  if (threads > 1)
+    diffusePool = new DiffusePool(this, threads);
+  setDiffusionMode(DEFAULT_DIFFUSION_MODE);
+  /* OUTSIDE units are never on the map, so they need no counter */
+  for (int t = UNIT_TYPE_EMPTY; t < UNIT_TYPE_OUTSIDE; t++) {
+    counters.push_back(RectCounter(size, t == UNIT_TYPE_EMPTY));
+  }
+  for (int s = SPAWNER_ID_ONE; s < players; s++) {
+    planes.push_back(ScentPlane(numUnits, chunksPerRow * chunksPerRow));
+    openDoors.push_back(BitPlane(numUnits));
+    int factor = 1;
+    for (int l = 0; l < SCENT_PYRAMID_LEVELS; l++) {
+      factor *= SCENT_PYRAMID_FACTOR;
+      planes.back().levels.push_back(ScentLevel(size, factor));
+    }
+  }
+  journal.reserve(numUnits);
+  passPlanes.reserve(planes.size());
+  reset();
+}
+
+MapGrid::~MapGrid() { delete diffusePool; }
+
+template <class T> static size_t vectorBytes(const std::vector<T> &v) {
+  return v.capacity() * sizeof(T);
+}
+
+/* Bytes the grid holds on the heap. Every array is sized when the grid is
+   made, so this doesn't change during a match */
+size_t MapGrid::heapBytes() {
+  size_t bytes = vectorBytes(types) + vectorBytes(hps) + vectorBytes(agents) +
+                 vectorBytes(buildings) + vectorBytes(doors) +
+                 vectorBytes(marks) + vectorBytes(journal) +
+                 vectorBytes(journaled.words) + vectorBytes(passPlanes) +
+                 vectorBytes(planes) + vectorBytes(occupancy) +
+                 vectorBytes(openDoors) + vectorBytes(counters) +
+                 vectorBytes(diffusion);
+  for (BitPlane &bits : occupancy) {
+    bytes += vectorBytes(bits.words);
+  }
+  for (BitPlane &bits : openDoors) {
+    bytes += vectorBytes(bits.words);
+  }
+  for (RectCounter &counter : counters) {
+    bytes += vectorBytes(counter.tree);
+  }
+  for (ScentPlane &plane : planes) {
+    bytes += vectorBytes(plane.objectives) +
+             vectorBytes(plane.objectiveEpochs) + vectorBytes(plane.scent) +
+             vectorBytes(plane.prevScent) + vectorBytes(plane.chunkMax) +
+             vectorBytes(plane.chunkAwake) +
+             vectorBytes(plane.awakeChunks) +
+             vectorBytes(plane.touchedChunks) +
+             vectorBytes(plane.chunkActive) +
+             vectorBytes(plane.activeChunks) +
+             vectorBytes(plane.sources.words) +
+             vectorBytes(plane.sourceList) +
+             vectorBytes(plane.changed.words) +
+             vectorBytes(plane.changedList) + vectorBytes(plane.hotChunks) +
+             vectorBytes(plane.nextAwake) +
+             vectorBytes(plane.nextAwakeChunks) + vectorBytes(plane.levels) +
+             vectorBytes(plane.levelBlocked.words);
+    for (ScentLevel &level : plane.levels) {
+      bytes += vectorBytes(level.scent) + vectorBytes(level.next) +
+               vectorBytes(level.coeff) + vectorBytes(level.blocked);
+    }
+  }
+  return bytes;
+}
+
+/* Put every array back to an empty map of the same size, reusing the
+   storage */
+void MapGrid::reset() {
+  std::fill(types.begin(), types.end(), UNIT_TYPE_OUTSIDE);
+  std::fill(hps.begin(), hps.end(), 0);
+  std::fill(agents.begin(), agents.end(), nullptr);
+  std::fill(buildings.begin(), buildings.end(), nullptr);
+  std::fill(doors.begin(), doors.end(), Door{SPAWNER_ID_ONE, 0, false});
+  markEpoch = 1;
+  std::fill(marks.begin(), marks.end(), 0);
+  for (BitPlane &bits : occupancy) {
+    std::fill(bits.words.begin(), bits.words.end(), 0);
+  }
+  for (BitPlane &bits : openDoors) {
+    std::fill(bits.words.begin(), bits.words.end(), 0);
+  }
+  std::fill(diffusion.begin(), diffusion.end(), 0);
+  clearJournal();
+  for (int t = UNIT_TYPE_EMPTY; t < UNIT_TYPE_OUTSIDE; t++) {
+    counters[t].reset(t == UNIT_TYPE_EMPTY);
+  }
+  /* Everything starts as the OUTSIDE border; carve the map out of it */
+  for (unsigned int i = 0; i < numUnits; i++) {
+    occupancy[UNIT_TYPE_OUTSIDE].set(i);
+  }
+  for (unsigned int y = 0; y < size; y++) {
+    for (unsigned int x = 0; x < size; x++) {
+      unsigned int i = indexOf(x, y);
+      types[i] = UNIT_TYPE_EMPTY;
+      occupancy[UNIT_TYPE_OUTSIDE].clear(i);
+      occupancy[UNIT_TYPE_EMPTY].set(i);
+      diffusion[i] = SCENT_COEFF;
+    }
+  }
+  for (ScentPlane &plane : planes) {
+    plane.reset();
+  }
+}
+
+/* Chunk holding the unit at index, which must be on the map */
+unsigned int MapGrid::chunkOf(unsigned int i) {
+  return (yOf(i) / SCENT_CHUNK_SIZE) * chunksPerRow + xOf(i) / SCENT_CHUNK_SIZE;
+}
+
+/* Record that scent s was put on the unit at index, so its chunk wakes up */
+void MapGrid::touchScent(unsigned int i, SpawnerID sid, double s) {
+  ScentPlane &plane = planes[sid];
+  for (ScentLevel &level : plane.levels) {
+    level.touch(xOf(i), yOf(i), s);
+  }
+  if (diffusionMode == DIFFUSION_MODE_RED_BLACK && !plane.sources.test(i)) {
+    plane.sources.set(i);
+    plane.sourceList.push_back(i);
+  }
+  unsigned int c = chunkOf(i);
+  if (s <= plane.chunkMax[c])
+    return;
+  /* A chunk is listed once, when it first holds enough scent to wake */
+  if (plane.chunkMax[c] <= SCENT_EPSILON && s > SCENT_EPSILON)
+    plane.touchedChunks.push_back(c);
+  plane.chunkMax[c] = s;
+}
+
+/* Keep the chunk of the unit at index awake for the player's next pass:
+   something there reads, puts or lets through scent */
+void MapGrid::keepAwake(unsigned int i, SpawnerID sid) {
+  ScentPlane &plane = planes[sid];
+  unsigned int c = chunkOf(i);
+  if (!plane.chunkActive[c]) {
+    plane.chunkActive[c] = true;
+    plane.activeChunks.push_back(c);
+  }
+}
+
+/* The same for every chunk the rectangle overlaps, clipped to the map */
+void MapGrid::keepAwake(int x, int y, int w, int h, SpawnerID sid) {
+  if (!clipRect(x, y, w, h))
+    return;
+  ScentPlane &plane = planes[sid];
+  for (int cy = y / SCENT_CHUNK_SIZE; cy <= (y + h - 1) / SCENT_CHUNK_SIZE;
+       cy++) {
+    for (int cx = x / SCENT_CHUNK_SIZE; cx <= (x + w - 1) / SCENT_CHUNK_SIZE;
+         cx++) {
+      unsigned int c = cy * chunksPerRow + cx;
+      if (!plane.chunkActive[c]) {
+        plane.chunkActive[c] = true;
+        plane.activeChunks.push_back(c);
+      }
+    }
+  }
+}
+
+/* The scent of the cells left of, right of, above and below the unit's own
+   cell on the finest level of the pyramid with any scent there; false if no
+   level has */
+bool MapGrid::coarseScents(unsigned int i, SpawnerID sid, Scent *out) {
+  int x = xOf(i);
+  int y = yOf(i);
+  for (ScentLevel &level : planes[sid].levels) {
+    if (level.most <= SCENT_EPSILON)
+      continue;
+    int c = level.cellOf(x, y);
+    Scent around[4] = {level.scent[c - 1], level.scent[c + 1],
+                       level.scent[c - level.stride],
+                       level.scent[c + level.stride]};
+    if (around[0] > 0 || around[1] > 0 || around[2] > 0 || around[3] > 0) {
+      for (int k = 0; k < 4; k++)
+        out[k] = around[k];
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Count the unit at index in the player's levels as keeping scent out of
+   its cells if the player's scent can't pass it and no agent is what stands
+   there, and as not otherwise. Agents come and go too often to steer by */
+void MapGrid::refreshLevels(unsigned int i, SpawnerID sid) {
+  ScentPlane &plane = planes[sid];
+  bool blocks = !isPassable(i, sid) && types[i] != UNIT_TYPE_AGENT;
+  if (blocks == plane.levelBlocked.test(i))
+    return;
+  if (blocks)
+    plane.levelBlocked.set(i);
+  else
+    plane.levelBlocked.clear(i);
+  for (ScentLevel &level : plane.levels) {
+    level.block(xOf(i), yOf(i), blocks ? 1 : -1);
+  }
+}
+
+/* The same for the units changed since the player's last pass began */
+void MapGrid::refreshLevels(SpawnerID sid) {
+  ScentPlane &plane = planes[sid];
+  if (plane.levels.empty())
+    return;
+  for (unsigned int i : plane.changedList) {
+    refreshLevels(i, sid);
+  }
+}
+
+/* Update the unit in place, with coefficient coeff: SCENT_COEFF if the
+   player can pass it and 0 if not */
+void MapGrid::updateUnit(unsigned int i, SpawnerID sid, Scent coeff) {
+  ScentPlane &plane = planes[sid];
+  plane.prevScent[i] = plane.scent[i];
+  // Left and up have already been iterated through while updating
+  plane.scent[i] = diffuseScent(coeff,
+                                plane.prevScent[neighbor(i, -1, 0)],
+                                plane.prevScent[neighbor(i, 0, -1)],
+                                plane.scent[neighbor(i, 1, 0)],
+                                plane.scent[neighbor(i, 0, 1)]);
+}
+
+/* The next value of the unit in Jacobi mode, written to prevScent */
+void MapGrid::jacobiUnit(unsigned int i, SpawnerID sid, Scent coeff) {
+  ScentPlane &plane = planes[sid];
+  plane.prevScent[i] = diffuseScent(coeff,
+                                    plane.scent[neighbor(i, -1, 0)],
+                                    plane.scent[neighbor(i, 0, -1)],
+                                    plane.scent[neighbor(i, 1, 0)],
+                                    plane.scent[neighbor(i, 0, 1)]);
+}
+
+/* Over-relax the unit in place toward the diffused scent of its neighbors.
+   Units objectives put scent on this tick are held as they are, and
+   impassable units are cleared */
+void MapGrid::relaxUnit(unsigned int i, SpawnerID sid, Scent coeff) {
+  ScentPlane &plane = planes[sid];
+  if (plane.sources.test(i))
+    return;
+  if (coeff == 0) {
+    plane.scent[i] = 0;
+    return;
+  }
+  Scent target = diffuseScent(coeff,
+                              plane.scent[neighbor(i, -1, 0)],
+                              plane.scent[neighbor(i, 0, -1)],
+                              plane.scent[neighbor(i, 1, 0)],
+                              plane.scent[neighbor(i, 0, 1)]);
+  double s = (1.0 - relaxation) * fromScent(plane.scent[i]) +
+             relaxation * fromScent(target);
+  plane.scent[i] = (s > fromScent(SCENT_FLUSH)) ? toScent(s) : 0;
+}
+
+/* Copy the w coefficients from coeff to out and open up the units whose
+   bits are set in open */
+static void openCoeffs(const Scent *coeff, uint64_t open, int w, Scent *out) {
+  memcpy(out, coeff, w * sizeof(Scent));
+  for (; open; open &= open - 1)
+    out[__builtin_ctzll(open)] = SCENT_COEFF;
+}
+
+/* Update the player's scent on a span of a row major grid with one call of
+   the grid's row stencil, and return the most scent left on it. An in place
+   pass copies the span to prevScent first; the results are the same as
+   MapGrid::updateUnit on every unit in order. A Jacobi pass reads only scent
+   and writes the next plane into prevScent */
+static double stencilSpan(MapGrid *grid, ScentPlane &plane, RowSpan r,
+                          const Scent *coeff, bool jacobi) {
+  const unsigned int stride = grid->stride;
+  Scent *scent = plane.scent.data();
+  Scent *prevScent = plane.prevScent.data();
+  unsigned int start = r.start;
+  if (jacobi)
+    return grid->stencilRow(prevScent + start, scent + start - 1,
+                            scent + start - stride, scent + start + 1,
+                            scent + start + stride, coeff, r.length);
+  /* The unit past the end is the right neighbor of the last one; its own
+     update will copy the same value again */
+  for (int k = 0; k <= r.length; k++)
+    prevScent[start + k] = scent[start + k];
+  return grid->stencilRow(scent + start, prevScent + start - 1,
+                          prevScent + start - stride, prevScent + start + 1,
+                          scent + start + stride, coeff, r.length);
+}
+
+/* Takes effect from the next diffuse; both modes leave the current scent in
+   scent between passes */
+void MapGrid::setDiffusionMode(DiffusionMode mode) { diffusionMode = mode; }
+
+/* The relaxation factor and number of sweeps a tick for red black mode */
+void MapGrid::setRelaxation(double omega, int sweeps) {
+  relaxation = omega;
+  relaxationSweeps = sweeps;
+}
+
+void MapGrid::diffuse(SpawnerID sid) { diffuse(&sid, 1); }
+
+/* Update the scent of each of the count players on every unit of their awake
+   chunks, in one pass over the map: each span of a row is done for every
+   plane before the next (see sweepRows), and the thread pool is started once
+   for all of them. The planes don't depend on each other, so each ends up
+   the same as if it were diffused on its own */
+void MapGrid::diffuse(const SpawnerID *sids, int count) {
+  passPlanes.clear();
+  for (int p = 0; p < count; p++) {
+    if (!planes[sids[p]].alive)
+      continue;
+    wakeChunks(sids[p]);
+    passPlanes.push_back(sids[p]);
+  }
+  if (passPlanes.empty())
+    return;
+  int n = chunksPerRow;
+  if (diffusionMode == DIFFUSION_MODE_RED_BLACK) {
+    for (int sweep = 0; sweep < relaxationSweeps; sweep++) {
+      for (int color = 0; color < 2; color++) {
+        if (diffusePool)
+          diffusePool->run(color);
+        else
+          relaxRows(0, n, color);
+      }
+    }
+  } else if (diffusePool) {
+    diffusePool->run();
+  } else {
+    diffuseRows(0, n);
+  }
+  for (SpawnerID sid : passPlanes) {
+    settleScent(sid);
+  }
+}
+
+/* Redo the player's last in place or Jacobi pass on the units changed
+   since it began, with the coefficients they have now, and clear the
+   plane's changed list. Both modes leave the scent from before the pass in
+   prevScent, so each such unit is diffused again from the same neighbors,
+   and the chunks they are in have their most scent taken again; the plane
+   ends up as if it had been diffused after the changes. Units in sleeping
+   chunks are left at zero, as the pass would leave them. Not for red black
+   mode, whose sweeps can't be redone a unit at a time */
+void MapGrid::rediffuseChanges(SpawnerID sid) {
+  ScentPlane &plane = planes[sid];
+  if (!plane.alive)
+    return;
+  std::vector<unsigned int> &changed = plane.hotChunks;
+  changed.clear();
+  for (unsigned int i : plane.changedList) {
+    unsigned int c = chunkOf(i);
+    if (!plane.chunkAwake[c])
+      continue;
+    plane.scent[i] =
+        diffuseScent(isPassable(i, sid) ? SCENT_COEFF : 0,
+                     plane.prevScent[neighbor(i, -1, 0)],
+                     plane.prevScent[neighbor(i, 0, -1)],
+                     plane.prevScent[neighbor(i, 1, 0)],
+                     plane.prevScent[neighbor(i, 0, 1)]);
+    if (!plane.nextAwake[c]) {
+      plane.nextAwake[c] = true;
+      changed.push_back(c);
+    }
+  }
+  int n = chunksPerRow;
+  for (unsigned int c : changed) {
+    plane.nextAwake[c] = false;
+    Scent m = 0;
+    RectView rect(this, (c % n) * SCENT_CHUNK_SIZE, (c / n) * SCENT_CHUNK_SIZE,
+                  SCENT_CHUNK_SIZE, SCENT_CHUNK_SIZE);
+    for (RowSpan r = rect.first(); r.length > 0; r = rect.next(r)) {
+      for (unsigned int i = r.start; i < r.end(); i++) {
+        if (plane.scent[i] > m)
+          m = plane.scent[i];
+      }
+    }
+    plane.chunkMax[c] = fromScent(m);
+  }
+  refreshLevels(sid);
+  plane.clearChanged();
+}
+
+/* Pick the chunks of the player's plane to update this pass. A chunk is
+   awake if it or one of the four chunks next to it holds more than
+   SCENT_EPSILON scent; otherwise only scent too small to matter could reach
+   it. Only the chunks that were awake for the last pass or were touched
+   since can hold that much, so the awake set is rebuilt from those alone.
+   Chunks marked by keepAwake since the last pass are awake too: agents and
+   objectives on them since, or units changed since. The pass sees every
+   change made before it, so once the levels have taken those in, the
+   plane's changed list starts over. A chunk that falls asleep has its
+   leftover scent cleared before the pass, so sleeping chunks hold none,
+   and the clearing only visits those chunks. This is an approximation: the
+   cleared scent is not diffused into the awake neighbors, so the result
+   can differ slightly from a sweep of every chunk (layout-bench measures by
+   how much) */
+void MapGrid::wakeChunks(SpawnerID sid) {
+  ScentPlane &plane = planes[sid];
+  refreshLevels(sid);
+  plane.clearChanged();
+  int n = chunksPerRow;
+  std::vector<unsigned int> &hot = plane.hotChunks;
+  hot.clear();
+  for (unsigned int c : plane.awakeChunks) {
+    if (plane.chunkMax[c] > SCENT_EPSILON)
+      hot.push_back(c);
+  }
+  for (unsigned int c : plane.touchedChunks) {
+    if (!plane.chunkAwake[c] && plane.chunkMax[c] > SCENT_EPSILON)
+      hot.push_back(c);
+  }
+  plane.touchedChunks.clear();
+  std::vector<unsigned char> &awake = plane.nextAwake;
+  std::vector<unsigned int> &awakeChunks = plane.nextAwakeChunks;
+  awakeChunks.clear();
+  auto wake = [&](unsigned int c) {
+    if (!awake[c]) {
+      awake[c] = true;
+      awakeChunks.push_back(c);
+    }
+  };
+  for (unsigned int c : hot) {
+    int cx = c % n;
+    int cy = c / n;
+    wake(c);
+    if (cx > 0)
+      wake(c - 1);
+    if (cx < n - 1)
+      wake(c + 1);
+    if (cy > 0)
+      wake(c - n);
+    if (cy < n - 1)
+      wake(c + n);
+  }
+  for (unsigned int c : plane.activeChunks) {
+    plane.chunkActive[c] = false;
+    wake(c);
+  }
+  plane.activeChunks.clear();
+  for (unsigned int c : plane.awakeChunks) {
+    plane.chunkAwake[c] = false;
+    if (awake[c])
+      continue;
+    RectView rect(this, (c % n) * SCENT_CHUNK_SIZE, (c / n) * SCENT_CHUNK_SIZE,
+                  SCENT_CHUNK_SIZE, SCENT_CHUNK_SIZE);
+    for (RowSpan r = rect.first(); r.length > 0; r = rect.next(r)) {
+      for (unsigned int i = r.start; i < r.end(); i++) {
+        plane.scent[i] = 0;
+        plane.prevScent[i] = 0;
+      }
+    }
+    plane.chunkMax[c] = 0.0;
+  }
+  /* chunkAwake is all clear now, ready to mark the pass after this one */
+  plane.chunkAwake.swap(awake);
+  /* In index order, so the chunk rows of a band are a run of the list and an
+     in place pass goes in index order */
+  std::sort(awakeChunks.begin(), awakeChunks.end());
+  plane.awakeChunks.swap(awakeChunks);
+}
+
+/* Finish the player's pass: drop the held sources, make the new scent
+   current and diffuse the pyramid */
+void MapGrid::settleScent(SpawnerID sid) {
+  ScentPlane &plane = planes[sid];
+  for (unsigned int i : plane.sourceList) {
+    plane.sources.clear(i);
+  }
+  plane.sourceList.clear();
+  /* Sleeping chunks are zero in both planes, so only the awake chunks,
+     which were all written, change */
+  if (jacobiPass())
+    plane.scent.swap(plane.prevScent);
+  for (ScentLevel &level : plane.levels) {
+    level.diffuse(stencilRow);
+  }
+}
+
+/* Update chunk rows first .. end - 1 of every plane in the pass */
+void MapGrid::diffuseRows(int first, int end) { sweepRows(first, end, -1); }
+
+/* The same for one red black half sweep, updating the units whose x + y has
+   the parity of color */
+void MapGrid::relaxRows(int first, int end, int color) {
+  sweepRows(first, end, color);
+}
+
+/* Update the awake chunks of chunk rows first .. end - 1 of every plane in
+   the pass: a red black half sweep of color, or with color -1 an in place or
+   Jacobi pass. The rows are walked once, a chunk's span of a row at a time,
+   and each span is done for every plane awake there before the next. Every
+   plane reads its coefficients straight from the shared diffusion mask; a
+   player's open door bits are only read where the DOOR bits show a door,
+   and a span with one of that player's doors open gets a copy with them
+   patched in. So what is read to tell where scent may go is the same
+   whatever the number of players; only the scent planes grow.
+   A Jacobi pass or a half sweep only writes prevScent or the units of its
+   color and the chunkMax of these rows, so disjoint row ranges can run at
+   the same time. In place, a unit reads its left and upper neighbors from
+   prevScent, which hold their values from before the pass whichever of the
+   two went first, so going by rows gives the same scent as going chunk by
+   chunk. A chunk's most scent is taken over all its rows, and in red black
+   mode over both halves, so after the last sweep it holds the maximum */
+void MapGrid::sweepRows(int first, int end, int color) {
+  int n = chunksPerRow;
+  bool jacobi = jacobiPass();
+  bool stencil = layout == GRID_LAYOUT_ROW_MAJOR && color < 0;
+  const BitPlane &door = occupancy[UNIT_TYPE_DOOR];
+  Scent own[SCENT_CHUNK_SIZE];
+  for (int cy = first; cy < end; cy++) {
+    int top = cy * SCENT_CHUNK_SIZE;
+    int bottom = std::min(top + SCENT_CHUNK_SIZE, (int)size);
+    for (int y = top; y < bottom; y++) {
+      for (int cx = 0; cx < n; cx++) {
+        unsigned int c = cy * n + cx;
+        RectView view(this, cx * SCENT_CHUNK_SIZE, y, SCENT_CHUNK_SIZE, 1);
+        for (RowSpan r = view.first(); r.length > 0; r = view.next(r)) {
+          /* Whether this is the first span of the chunk to be done */
+          bool restart = color <= 0 && y == top && r.x == view.x;
+          uint64_t doors = door.run(r.start) & (((uint64_t)1 << r.length) - 1);
+          for (SpawnerID sid : passPlanes) {
+            ScentPlane &plane = planes[sid];
+            if (!plane.chunkAwake[c])
+              continue;
+            const Scent *coeff = diffusion.data() + r.start;
+            uint64_t open = doors ? openDoors[sid].run(r.start) & doors : 0;
+            if (open) {
+              openCoeffs(coeff, open, r.length, own);
+              coeff = own;
+            }
+            double most;
+            if (stencil) {
+              most = stencilSpan(this, plane, r, coeff, jacobi);
+            } else {
+              std::vector<Scent> &out =
+                  (color < 0 && jacobi) ? plane.prevScent : plane.scent;
+              Scent m = 0;
+              int k = (color < 0) ? 0 : ((r.x + r.y + color) & 1);
+              for (; k < r.length; k += (color < 0) ? 1 : 2) {
+                unsigned int i = r.start + k;
+                if (color >= 0)
+                  relaxUnit(i, sid, coeff[k]);
+                else if (jacobi)
+                  jacobiUnit(i, sid, coeff[k]);
+                else
+                  updateUnit(i, sid, coeff[k]);
+                if (out[i] > m)
+                  m = out[i];
+              }
+              most = fromScent(m);
+            }
+            if (restart || most > plane.chunkMax[c])
+              plane.chunkMax[c] = most;
+          }
+        }
+      }
+    }
+  }
+}
+
+/* Unmark every unit. The stamps are only swept when the epoch wraps */
+void MapGrid::clearMarks() {
+  markEpoch++;
+  if (markEpoch == 0) {
+    std::fill(marks.begin(), marks.end(), 0);
+    markEpoch = 1;
+  }
+}
+
+/* Drop every objective tag in the player's plane */
+void MapGrid::clearObjectives(SpawnerID s) {
+  ScentPlane &plane = planes[s];
+  plane.epoch++;
+  if (plane.epoch == 0) {
+    std::fill(plane.objectiveEpochs.begin(), plane.objectiveEpochs.end(), 0);
+    plane.epoch = 1;
+  }
+}
+
+void MapGrid::clearJournal() {
+  for (CellChange &c : journal) {
+    journaled.clear(c.index);
+  }
+  journal.clear();
+}
+
+void MapGrid::setType(unsigned int i, UnitType t) {
+  if (types[i] != t) {
+    logChange(i);
+    counters[types[i]].add(xOf(i), yOf(i), -1);
+    counters[t].add(xOf(i), yOf(i), 1);
+    occupancy[types[i]].clear(i);
+    occupancy[t].set(i);
+    types[i] = t;
+    diffusion[i] = (t == UNIT_TYPE_EMPTY) ? SCENT_COEFF : 0;
+  }
+  refreshDoor(i);
+}
+
+/* Fill an empty grid with the walls and doors of a map file, given as size *
+   size MapCell bytes in row major order. Runs of empty units are skipped a
+   word at a time, and the wall and door counters are built in bulk; since the
+   Fenwick tree is linear, the EMPTY tree is the full tree less those two.
+   Each wall and door is counted in the scent levels as it goes in */
+void MapGrid::loadTerrain(const unsigned char *cells) {
+  RectCounter &walls = counters[UNIT_TYPE_WALL];
+  RectCounter &doorCount = counters[UNIT_TYPE_DOOR];
+  int n = size + 1;
+  for (unsigned int y = 0; y < size; y++) {
+    const unsigned char *row = cells + (size_t)y * size;
+    unsigned int x = 0;
+    while (x < size) {
+      uint64_t word;
+      if (x + 8 <= size) {
+        memcpy(&word, row + x, sizeof(word));
+        if (word == 0) {
+          x += 8;
+          continue;
+        }
+      }
+      unsigned char c = row[x];
+      if (c != MAP_CELL_EMPTY) {
+        unsigned int i = indexOf(x, y);
+        UnitType t = UNIT_TYPE_WALL;
+        if (c == MAP_CELL_WALL) {
+          hps[i] = STARTING_WALL_HEALTH;
+          walls.tree[(y + 1) * n + x + 1]++;
+        } else {
+          t = UNIT_TYPE_DOOR;
+          doors[i] = {(SpawnerID)(c - MAP_CELL_DOOR), MAX_DOOR_HEALTH, true};
+          doorCount.tree[(y + 1) * n + x + 1]++;
+        }
+        types[i] = t;
+        occupancy[UNIT_TYPE_EMPTY].clear(i);
+        occupancy[t].set(i);
+        diffusion[i] = 0;
+        refreshDoor(i);
+        for (unsigned int s = 0; s < planes.size(); s++)
+          refreshLevels(i, (SpawnerID)s);
+      }
+      x++;
+    }
+  }
+  walls.build();
+  doorCount.build();
+  std::vector<int> &empty = counters[UNIT_TYPE_EMPTY].tree;
+  for (size_t k = 0; k < empty.size(); k++) {
+    empty[k] -= walls.tree[k] + doorCount.tree[k];
+  }
+}
+
+/* Bring each player's open door bit for the unit at i up to date with its
+   type and door state. Every change to either comes through here, and a
+   door opening or closing goes in the journal */
+void MapGrid::refreshDoor(unsigned int i) {
+  for (unsigned int s = 0; s < openDoors.size(); s++) {
+    bool open = types[i] == UNIT_TYPE_DOOR && doors[i].sid == (SpawnerID)s &&
+                doors[i].hp == MAX_DOOR_HEALTH && doors[i].isEmpty;
+    if (open == openDoors[s].test(i))
+      continue;
+    logChange(i);
+    if (open)
+      openDoors[s].set(i);
+    else
+      openDoors[s].clear(i);
+  }
+}
+
+/* Clip the rectangle to the map; false if nothing of it is left */
+bool MapGrid::clipRect(int &x, int &y, int &w, int &h) {
+  if (x < 0) {
+    w += x;
+    x = 0;
+  }
+  if (y < 0) {
+    h += y;
+    y = 0;
+  }
+  if (x + w > (int)size)
+    w = size - x;
+  if (y + h > (int)size)
+    h = size - y;
+  return (w > 0 && h > 0);
+}
+
+/* Number of units of the rectangle that are on the map */
+int MapGrid::rectArea(int x, int y, int w, int h) {
+  return clipRect(x, y, w, h) ? w * h : 0;
+}
+
+/* Number of units of type t in the rectangle, clipped to the map */
+int MapGrid::countRect(UnitType t, int x, int y, int w, int h) {
+  if (!clipRect(x, y, w, h))
+    return 0;
+  return counters[t].count(x, y, w, h);
+}
@@ -8,11 +8,13 @@
 #endif
 
 #include <pthread.h>
+#include <stdio.h>
 
 #include <iostream>
 #include <string>
 
 #include "game.h"
+#include "mapfile.h"
 #include "panel.h"
 
 #ifdef __EMSCRIPTEN__
@@ -177,6 +179,7 @@ void NetHandler::send(void *data, int numBytes) {
 }
 
 void NetHandler::receive(void *data, int numBytes, bool isText) {
+  int pn;
   pthread_mutex_lock(&game->threadLock);
   switch (ncon) {
   case NET_CONTEXT_INIT:
@@ -184,39 +187,40 @@ void NetHandler::receive(void *data, int numBytes, bool isText) {
   case NET_CONTEXT_CONNECTED:
     if (isText) {
       if (strcmp((char *)data, pairString) == 0) {
+        /* The server only starts the match if every player's map hash
+           matches; no map is the default terrain and hashes to 0 */
+        char ready[32];
+        snprintf(ready, sizeof(ready), "Ready %016llx",
+                 game->mapFile ? (unsigned long long)game->mapFile->hash()
+                               : 0ull);
         ncon = NET_CONTEXT_READY;
-        sendText("Ready");
+        sendText(ready);
+      } else if (strcmp((char *)data, "MAP_MISMATCH") == 0) {
+        game->end(DONE_STATUS_MAP_MISMATCH);
       }
     }
     break;
   case NET_CONTEXT_READY:
     if (isText) {
-      if (strcmp((char *)data, "P1") == 0) {
-        game->playerSpawnID = SPAWNER_ID_ONE;
-        game->panel->addText("You are the GREEN team.");
-        sendText("Set");
-      } else if (strcmp((char *)data, "P2") == 0) {
-        ncon = NET_CONTEXT_PLAYING;
-        game->playerSpawnID = SPAWNER_ID_TWO;
-        game->panel->addText("You are the RED team.");
-        game->flipped_X = true;
-        game->flipped_Y = true;
-        game->context = GAME_CONTEXT_STARTUPTIMER;
-        sendText("Set");
-      } else if (strcmp((char *)data, "P3") == 0) {
-        ncon = NET_CONTEXT_PLAYING;
-        game->playerSpawnID = SPAWNER_ID_THREE;
-        game->panel->addText("You are the BLUE team.");
-        game->flipped_Y = true;
-        game->context = GAME_CONTEXT_STARTUPTIMER;
-        sendText("Set");
-      } else if (strcmp((char *)data, "P4") == 0) {
-        ncon = NET_CONTEXT_PLAYING;
-        game->playerSpawnID = SPAWNER_ID_FOUR;
-        game->panel->addText("You are the YELLOW team.");
-        game->flipped_X = true;
-        game->context = GAME_CONTEXT_STARTUPTIMER;
+      if (sscanf((char *)data, "P%d", &pn) == 1 && pn >= 1 &&
+          pn <= game->numPlayers) {
+        /* Flip the view so every player's spawner is drawn at the bottom or
+           the right */
+        static const bool flips[MAX_PLAYERS][2] = {
+            {false, false}, {true, true}, {false, true}, {true, false},
+            {false, true}, {false, false}, {true, false}, {false, false}};
+        game->playerSpawnID = (SpawnerID)(pn - 1);
+        game->panel->addText(
+            ("You are the " + game->colorScheme[pn - 1].name + " team.").c_str());
+        game->flipped_X = flips[pn - 1][0];
+        game->flipped_Y = flips[pn - 1][1];
+        if (pn > 1) {
+          ncon = NET_CONTEXT_PLAYING;
+          game->context = GAME_CONTEXT_STARTUPTIMER;
+        }
         sendText("Set");
+      } else if (strcmp((char *)data, "MAP_MISMATCH") == 0) {
+        game->end(DONE_STATUS_MAP_MISMATCH);
       } else if (strcmp((char *)data, "Go") == 0) {
         game->context = GAME_CONTEXT_STARTUPTIMER;
         ncon = NET_CONTEXT_PLAYING;
@@ -235,17 +239,9 @@ void NetHandler::receive(void *data, int numBytes, bool isText) {
             game->sendEventsBuffer();
           }
         }
-      } else if (strcmp((char *)data, "WINNER_1") == 0) {
-        game->winnerSpawnID = SPAWNER_ID_ONE;
-        game->end(DONE_STATUS_WINRECV);
-      } else if (strcmp((char *)data, "WINNER_2") == 0) {
-        game->winnerSpawnID = SPAWNER_ID_TWO;
-        game->end(DONE_STATUS_WINRECV);
-      } else if (strcmp((char *)data, "WINNER_3") == 0) {
-        game->winnerSpawnID = SPAWNER_ID_THREE;
-        game->end(DONE_STATUS_WINRECV);
-      } else if (strcmp((char *)data, "WINNER_4") == 0) {
-        game->winnerSpawnID = SPAWNER_ID_FOUR;
+      } else if (sscanf((char *)data, "WINNER_%d", &pn) == 1 && pn >= 1 &&
+                 pn <= game->numPlayers) {
+        game->winnerSpawnID = (SpawnerID)(pn - 1);
         game->end(DONE_STATUS_WINRECV);
       } else if (strcmp((char *)data, "TIMEOUT") == 0) {
         game->end(DONE_STATUS_TIMEOUT);
@@ -256,6 +252,8 @@ void NetHandler::receive(void *data, int numBytes, bool isText) {
         game->end(DONE_STATUS_RESIGN);
       } else if (strcmp((char *)data, "FRAME_TIMEOUT") == 0) {
         game->end(DONE_STATUS_FRAME_TIMEOUT);
+      } else if (strcmp((char *)data, "MAP_MISMATCH") == 0) {
+        game->end(DONE_STATUS_MAP_MISMATCH);
       }
     } else {
       game->receiveData(data, numBytes);
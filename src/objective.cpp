@@ -2,8 +2,14 @@
 
 #include "constants.h"
 #include "game.h"
+#include "heapbudget.h"
 #include "mapunit.h"
 
+Pool<Objective> Objective::pool;
+
+static_assert(sizeof(Objective) <= OBJECTIVE_BYTES,
+              "OBJECTIVE_BYTES is too small for the heap plan");
+
 Objective::Objective(ObjectiveType t, int s, Game *g, SDL_Rect r,
                      SpawnerID _sid)
     : type(t), strength(s), done(false), sid(_sid), game(g), region(r) {
@@ -28,9 +34,8 @@ Objective::Objective(ObjectiveType t, int s, Game *g, SDL_Rect r,
   }
 }
 
-MapUnit::iterator Objective::getIterator() {
-  MapUnit *first = game->mapUnitAt(region.x, region.y);
-  return first->getIterator(region.w, region.h);
+RectView Objective::getView() {
+  return RectView(&game->grid, region.x, region.y, region.w, region.h);
 }
 
 bool Objective::isDone() {
@@ -47,12 +52,25 @@ bool Objective::isDone() {
 }
 
 bool Objective::regionIsReadyForBuilding() {
-  for (MapUnit::iterator it = getIterator(); it.hasNext(); it++) {
-    if (!((it->type == UNIT_TYPE_EMPTY) ||
-          (it->type == UNIT_TYPE_AGENT &&
-           it->agent->sid == game->playerSpawnID)))
+  MapGrid &grid = game->grid;
+  UnitType blocking[4] = {UNIT_TYPE_BUILDING, UNIT_TYPE_SPAWNER,
+                          UNIT_TYPE_WALL, UNIT_TYPE_DOOR};
+  for (UnitType t : blocking) {
+    if (grid.countRect(t, region.x, region.y, region.w, region.h) != 0)
       return false;
   }
+  if (grid.countRect(UNIT_TYPE_AGENT, region.x, region.y, region.w,
+                     region.h) == 0)
+    return true;
+  /* Only the agents in the region need checking one by one */
+  RectView view = getView();
+  for (RowSpan r = view.first(); r.length > 0; r = view.next(r)) {
+    for (unsigned int i = r.start; i < r.end(); i++) {
+      if (grid.types[i] == UNIT_TYPE_AGENT &&
+          grid.agents[i]->sid != game->playerSpawnID)
+        return false;
+    }
+  }
   return true;
 }
 
@@ -63,23 +81,23 @@ void Objective::updateCiter(UnitType desired, int desiredHP) {
     while (citer->hasPrev() and !past_done) {
       past_done = true;
       (*citer)--;
-      for (MapUnit *m : citer->current) {
-        if (m->type != desired || (m->type == desired && m->hp < desiredHP)) past_done = false;
+      for (MapUnit &m : citer->current) {
+        if (m.type() != desired || (m.type() == desired && m.hp() < desiredHP)) past_done = false;
       }
     }
     if (past_done) (*citer)++;
   }
   bool current_done = true;
-  for (MapUnit *m : citer->current) {
-    if (m->type != desired || (m->type == desired && m->hp < desiredHP)) {
+  for (MapUnit &m : citer->current) {
+    if (m.type() != desired || (m.type() == desired && m.hp() < desiredHP)) {
       current_done = false;
-      if (m->type == UNIT_TYPE_EMPTY) {
-        m->playerDict[psid].objective = this;
-        m->setScent(strength);
+      if (m.type() == UNIT_TYPE_EMPTY) {
+        m.setObjective(psid, this);
+        m.setScent(strength);
       }
-      if (m->type == desired) {
-        m->playerDict[psid].objective = this;
-        m->setEmptyNeighborScents(strength);
+      if (m.type() == desired) {
+        m.setObjective(psid, this);
+        m.setEmptyNeighborScents(strength);
       }
     }
   }
@@ -91,6 +109,8 @@ void Objective::updateCiter(UnitType desired, int desiredHP) {
 
 void Objective::update() {
   SpawnerID psid = game->getPlayerSpawnID();
+  RectView view = getView();
+  game->grid.keepAwake(region.x, region.y, region.w, region.h, psid);
   switch (type) {
   case OBJECTIVE_TYPE_BUILD_WALL:
     updateCiter(UNIT_TYPE_WALL, 0);
@@ -100,108 +120,134 @@ void Objective::update() {
     break;
   case OBJECTIVE_TYPE_ATTACK:
     done = true;
-    for (MapUnit::iterator m = getIterator(); m.hasNext(); m++) {
-      switch (m->type) {
-      case UNIT_TYPE_AGENT:
-        if (m->agent->getSpawnID() != game->getPlayerSpawnID()) {
+    /* Nothing to attack in a region that is all empty */
+    if (game->grid.countRect(UNIT_TYPE_EMPTY, region.x, region.y, region.w,
+                             region.h) ==
+        game->grid.rectArea(region.x, region.y, region.w, region.h))
+      break;
+    for (RowSpan r = view.first(); r.length > 0; r = view.next(r)) {
+      for (unsigned int i = r.start; i < r.end(); i++) {
+        MapUnit m = view.grid->unitAt(i);
+        switch (m.type()) {
+        case UNIT_TYPE_AGENT:
+          if (m.agent()->getSpawnID() != game->getPlayerSpawnID()) {
+            done = false;
+            m.setObjective(psid, this);
+            m.setEmptyNeighborScents(strength);
+          }
+          break;
+        case UNIT_TYPE_SPAWNER:
+          if (m.building()->type == BUILDING_TYPE_SPAWNER &&
+              m.building()->sid == game->getPlayerSpawnID())
+            break;
           done = false;
-          m->playerDict[psid].objective = this;
-          m->setEmptyNeighborScents(strength);
-        }
-        break;
-      case UNIT_TYPE_SPAWNER:
-        if (m->building->type == BUILDING_TYPE_SPAWNER &&
-            m->building->sid == game->getPlayerSpawnID())
+          m.setObjective(psid, this);
+          m.setEmptyNeighborScents(strength);
+          break;
+        case UNIT_TYPE_DOOR:
+          if (m.door().sid != game->getPlayerSpawnID()) {
+            done = false;
+            m.setObjective(psid, this);
+            m.setEmptyNeighborScents(strength);
+          }
           break;
-        done = false;
-        m->playerDict[psid].objective = this;
-        m->setEmptyNeighborScents(strength);
-        break;
-      case UNIT_TYPE_DOOR:
-        if (m->door->sid != game->getPlayerSpawnID()) {
+        case UNIT_TYPE_WALL:
           done = false;
-          m->playerDict[psid].objective = this;
-          m->setEmptyNeighborScents(strength);
+          m.setObjective(psid, this);
+          m.setEmptyNeighborScents(strength);
+          break;
+        case UNIT_TYPE_BUILDING:
+          done = false;
+          m.setObjective(psid, this);
+          m.setEmptyNeighborScents(strength);
+          break;
+        default:
+          break;
         }
-        break;
-      case UNIT_TYPE_WALL:
-        done = false;
-        m->playerDict[psid].objective = this;
-        m->setEmptyNeighborScents(strength);
-        break;
-      case UNIT_TYPE_BUILDING:
-        done = false;
-        m->playerDict[psid].objective = this;
-        m->setEmptyNeighborScents(strength);
-        break;
-      default:
-        break;
       }
     }
     break;
   case OBJECTIVE_TYPE_GOTO:
-    for (MapUnit::iterator m = getIterator(); m.hasNext(); m++) {
-      if (m->type == UNIT_TYPE_EMPTY)
-        m->setScent(strength);
+    for (RowSpan r = view.first(); r.length > 0; r = view.next(r)) {
+      for (unsigned int i = r.start; i < r.end(); i++) {
+        MapUnit m = view.grid->unitAt(i);
+        if (m.type() == UNIT_TYPE_EMPTY)
+          m.setScent(strength);
+      }
     }
   case OBJECTIVE_TYPE_BUILD_DOOR:
     done = true;
-    for (MapUnit::iterator m = getIterator(); m.hasNext(); m++) {
-      switch (m->type) {
-      case UNIT_TYPE_DOOR:
-        if (m->door->hp < MAX_DOOR_HEALTH) {
+    if (game->grid.countRect(UNIT_TYPE_WALL, region.x, region.y, region.w,
+                             region.h) +
+            game->grid.countRect(UNIT_TYPE_DOOR, region.x, region.y, region.w,
+                                 region.h) ==
+        0)
+      break;
+    for (RowSpan r = view.first(); r.length > 0; r = view.next(r)) {
+      for (unsigned int i = r.start; i < r.end(); i++) {
+        MapUnit m = view.grid->unitAt(i);
+        switch (m.type()) {
+        case UNIT_TYPE_DOOR:
+          if (m.door().hp < MAX_DOOR_HEALTH) {
+            done = false;
+            m.setObjective(psid, this);
+            m.setEmptyNeighborScents(strength);
+          }
+          break;
+        case UNIT_TYPE_WALL:
           done = false;
-          m->playerDict[psid].objective = this;
-          m->setEmptyNeighborScents(strength);
+          m.setObjective(psid, this);
+          m.setEmptyNeighborScents(strength);
+          break;
+        default:
+          break;
         }
-        break;
-      case UNIT_TYPE_WALL:
-        done = false;
-        m->playerDict[psid].objective = this;
-        m->setEmptyNeighborScents(strength);
-        break;
-      default:
-        break;
       }
     }
     break;
   case OBJECTIVE_TYPE_BUILD_TOWER:
     done = true;
     if (!started) {
-      MapUnit *center =
+      MapUnit center =
           game->mapUnitAt(region.x + region.w / 2, region.y + region.h / 2);
-      if (center->type == UNIT_TYPE_EMPTY) {
-        center->setScent(strength);
-        center->playerDict[psid].objective = this;
+      if (center.type() == UNIT_TYPE_EMPTY) {
+        center.setScent(strength);
+        center.setObjective(psid, this);
       }
       done = false;
       break;
     }
-    for (MapUnit::iterator m = getIterator(); m.hasNext(); m++) {
-      if (m->building->hp < m->building->max_hp) {
-        m->playerDict[psid].objective = this;
-        m->setEmptyNeighborScents(strength);
-        done = false;
+    for (RowSpan r = view.first(); r.length > 0; r = view.next(r)) {
+      for (unsigned int i = r.start; i < r.end(); i++) {
+        MapUnit m = view.grid->unitAt(i);
+        if (m.building()->hp < m.building()->max_hp) {
+          m.setObjective(psid, this);
+          m.setEmptyNeighborScents(strength);
+          done = false;
+        }
       }
     }
     break;
   case OBJECTIVE_TYPE_BUILD_BOMB:
     done = true;
     if (!started) {
-      MapUnit *center =
+      MapUnit center =
           game->mapUnitAt(region.x + region.w / 2, region.y + region.h / 2);
-      if (center->type == UNIT_TYPE_EMPTY) {
-        center->setScent(strength);
-        center->playerDict[psid].objective = this;
+      if (center.type() == UNIT_TYPE_EMPTY) {
+        center.setScent(strength);
+        center.setObjective(psid, this);
       }
       done = false;
       break;
     }
-    for (MapUnit::iterator m = getIterator(); m.hasNext(); m++) {
-      if (m->building->hp < m->building->max_hp) {
-        m->playerDict[psid].objective = this;
-        m->setEmptyNeighborScents(strength);
-        done = false;
+    for (RowSpan r = view.first(); r.length > 0; r = view.next(r)) {
+      for (unsigned int i = r.start; i < r.end(); i++) {
+        MapUnit m = view.grid->unitAt(i);
+        if (m.building()->hp < m.building()->max_hp) {
+          m.setObjective(psid, this);
+          m.setEmptyNeighborScents(strength);
+          done = false;
+        }
       }
     }
     break;
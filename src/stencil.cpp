@@ -0,0 +1,207 @@
+#include "stencil.h"
+
+#include <chrono>
+#include <vector>
+
+/* The vector versions are only built for x86, each in its own target so the
+   rest of the program keeps the baseline instruction set; the CPU is asked
+   at runtime which of them it can run, and the fastest of those is used */
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(__EMSCRIPTEN__)
+#define STENCIL_X86 1
+#include <immintrin.h>
+#endif
+
+const char *stencilISANames[STENCIL_ISA_AVX512 + 1] = {"scalar", "sse2", "avx2",
+                                                       "avx512"};
+
+/* The scalar reference, also used for the units left over at the end of a
+   row by the vector versions */
+static Scent stencilTail(Scent *__restrict out, const Scent *left,
+                         const Scent *up, const Scent *right, const Scent *down,
+                         const Scent *coeff, int k, int w, Scent most) {
+  for (; k < w; k++) {
+    out[k] = diffuseScent(coeff[k], left[k], up[k], right[k], down[k]);
+    if (out[k] > most)
+      most = out[k];
+  }
+  return most;
+}
+
+/* Largest of the n lanes stored at lanes, and at least most */
+static Scent laneMax(const Scent *lanes, int n, Scent most) {
+  for (int i = 0; i < n; i++) {
+    if (lanes[i] > most)
+      most = lanes[i];
+  }
+  return most;
+}
+
+static double stencilRowScalar(Scent *out, const Scent *left, const Scent *up,
+                               const Scent *right, const Scent *down,
+                               const Scent *coeff, int w) {
+  return fromScent(stencilTail(out, left, up, right, down, coeff, 0, w, 0));
+}
+
+#ifdef STENCIL_X86
+
+__attribute__((target("sse2"))) static double
+stencilRowSSE2(Scent *out, const Scent *left, const Scent *up,
+               const Scent *right, const Scent *down, const Scent *coeff,
+               int w) {
+  __m128d most = _mm_setzero_pd();
+  __m128d flush = _mm_set1_pd(SCENT_FLUSH);
+  int k = 0;
+  for (; k + 2 <= w; k += 2) {
+    __m128d sum = _mm_add_pd(_mm_loadu_pd(left + k), _mm_loadu_pd(up + k));
+    sum = _mm_add_pd(sum, _mm_loadu_pd(right + k));
+    sum = _mm_add_pd(sum, _mm_loadu_pd(down + k));
+    __m128d v = _mm_mul_pd(_mm_loadu_pd(coeff + k), sum);
+    v = _mm_and_pd(v, _mm_cmpgt_pd(v, flush));
+    _mm_storeu_pd(out + k, v);
+    most = _mm_max_pd(most, v);
+  }
+  Scent lanes[2];
+  _mm_storeu_pd(lanes, most);
+  Scent m = laneMax(lanes, 2, 0);
+  return stencilTail(out, left, up, right, down, coeff, k, w, m);
+}
+
+__attribute__((target("avx2"))) static double
+stencilRowAVX2(Scent *out, const Scent *left, const Scent *up,
+               const Scent *right, const Scent *down, const Scent *coeff,
+               int w) {
+  __m256d most = _mm256_setzero_pd();
+  __m256d flush = _mm256_set1_pd(SCENT_FLUSH);
+  int k = 0;
+  for (; k + 4 <= w; k += 4) {
+    __m256d sum =
+        _mm256_add_pd(_mm256_loadu_pd(left + k), _mm256_loadu_pd(up + k));
+    sum = _mm256_add_pd(sum, _mm256_loadu_pd(right + k));
+    sum = _mm256_add_pd(sum, _mm256_loadu_pd(down + k));
+    __m256d v = _mm256_mul_pd(_mm256_loadu_pd(coeff + k), sum);
+    v = _mm256_and_pd(v, _mm256_cmp_pd(v, flush, _CMP_GT_OQ));
+    _mm256_storeu_pd(out + k, v);
+    most = _mm256_max_pd(most, v);
+  }
+  Scent lanes[4];
+  _mm256_storeu_pd(lanes, most);
+  Scent m = laneMax(lanes, 4, 0);
+  return stencilTail(out, left, up, right, down, coeff, k, w, m);
+}
+
+__attribute__((target("avx512f"))) static double
+stencilRowAVX512(Scent *out, const Scent *left, const Scent *up,
+                 const Scent *right, const Scent *down, const Scent *coeff,
+                 int w) {
+  __m512d most = _mm512_setzero_pd();
+  __m512d flush = _mm512_set1_pd(SCENT_FLUSH);
+  int k = 0;
+  for (; k + 8 <= w; k += 8) {
+    __m512d sum =
+        _mm512_add_pd(_mm512_loadu_pd(left + k), _mm512_loadu_pd(up + k));
+    sum = _mm512_add_pd(sum, _mm512_loadu_pd(right + k));
+    sum = _mm512_add_pd(sum, _mm512_loadu_pd(down + k));
+    __m512d v = _mm512_mul_pd(_mm512_loadu_pd(coeff + k), sum);
+    v = _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(v, flush, _CMP_GT_OQ), v);
+    _mm512_storeu_pd(out + k, v);
+    /* The masked form with every lane set; the plain one trips a false
+       uninitialized warning in the compiler's own header */
+    most = _mm512_mask_max_pd(most, 0xff, most, v);
+  }
+  Scent lanes[8];
+  _mm512_storeu_pd(lanes, most);
+  Scent m = laneMax(lanes, 8, 0);
+  return stencilTail(out, left, up, right, down, coeff, k, w, m);
+}
+
+#endif
+
+bool stencilSupported(StencilISA isa) {
+#ifdef STENCIL_X86
+  __builtin_cpu_init();
+  switch (isa) {
+  case STENCIL_ISA_SSE2:
+    return __builtin_cpu_supports("sse2");
+  case STENCIL_ISA_AVX2:
+    return __builtin_cpu_supports("avx2");
+  case STENCIL_ISA_AVX512:
+    return __builtin_cpu_supports("avx512f");
+  default:
+    break;
+  }
+#endif
+  return isa == STENCIL_ISA_SCALAR;
+}
+
+/* Microseconds row takes over STENCIL_TIMING_SPANS spans of
+   SCENT_CHUNK_SIZE units, the most sweepRows hands it at once, laid out as
+   in a scent plane; the best of STENCIL_TIMING_ROUNDS rounds */
+double stencilSpanTime(StencilRow row) {
+  int stride = STENCIL_TIMING_SPANS * SCENT_CHUNK_SIZE + 2;
+  std::vector<Scent> scent(3 * stride), out(3 * stride, 0);
+  std::vector<Scent> coeff(3 * stride, SCENT_COEFF);
+  for (int i = 0; i < 3 * stride; i++)
+    scent[i] = toScent(1.0 + i % 251);
+  double best = 0.0;
+  double sink = 0.0;
+  for (int round = 0; round < STENCIL_TIMING_ROUNDS; round++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < STENCIL_TIMING_SPANS; s++) {
+      int i = stride + 1 + s * SCENT_CHUNK_SIZE;
+      sink += row(out.data() + i, scent.data() + i - 1,
+                  scent.data() + i - stride, scent.data() + i + 1,
+                  scent.data() + i + stride, coeff.data() + i,
+                  SCENT_CHUNK_SIZE);
+    }
+    std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (round == 0 || elapsed.count() < best)
+      best = elapsed.count();
+  }
+  /* Keep the spans from being optimized away */
+  if (sink == -1.0)
+    best += sink;
+  return best;
+}
+
+/* The supported version that diffuses spans fastest on this CPU. All of
+   them give the same bits, so this only changes speed: the widest is not
+   always fastest on SCENT_CHUNK_SIZE spans, where a wide version does few
+   full steps and its setup and tail weigh more. Timed once, the first time
+   it is asked */
+static StencilISA fastestStencilISA() {
+  StencilISA best = STENCIL_ISA_SCALAR;
+  double bestTime = stencilSpanTime(stencilRowFor(best));
+  for (int isa = STENCIL_ISA_SSE2; isa <= STENCIL_ISA_AVX512; isa++) {
+    if (!stencilSupported((StencilISA)isa))
+      continue;
+    double t = stencilSpanTime(stencilRowFor((StencilISA)isa));
+    if (t < bestTime) {
+      best = (StencilISA)isa;
+      bestTime = t;
+    }
+  }
+  return best;
+}
+
+StencilISA bestStencilISA() {
+  static const StencilISA best = fastestStencilISA();
+  return best;
+}
+
+/* The row function for isa, or the scalar reference if this build has no
+   version for it */
+StencilRow stencilRowFor(StencilISA isa) {
+  switch (isa) {
+#ifdef STENCIL_X86
+  case STENCIL_ISA_SSE2:
+    return stencilRowSSE2;
+  case STENCIL_ISA_AVX2:
+    return stencilRowAVX2;
+  case STENCIL_ISA_AVX512:
+    return stencilRowAVX512;
+#endif
+  default:
+    return stencilRowScalar;
+  }
+}
@@ -0,0 +1,2 @@
+# Made by make webmemory: ./heap-plan 200 4
+WEBINITIALMEMORY=77463552
@@ -28,12 +28,8 @@ if (window.mobileAndTabletCheck()) {
 	Math.floor((6/7)*(window.innerHeight - gameWindowPadding)/gameSize)
     );
 }
-const memory = new WebAssembly.Memory({
-    initial: 1024,
-    maximum: 16384,
-    shared: true,
-});
-Module['wasmMemory'] = memory;
+// The build makes its own memory, sized from the heap plan of the largest
+// match played here (see heap-plan in the Makefile) and able to grow past it
 Module['arguments'] = [
     gameSize.toString(),
     gamePanelSize.toString(),
@@ -46,6 +42,22 @@ Module['arguments'] = [
 if (window.mobileAndTabletCheck()) {
     Module['arguments'].push('mobile');
 }
+// ?map=<name> plays on /maps/<name>.pmap (made with genmap.py), copied into
+// the game's file system before it starts. If it can't be fetched the game
+// plays on the default terrain. Online players must all be on the same map
+// or the server won't start the match
+var mapName = new URLSearchParams(window.location.search).get('map');
+if (mapName && /^[A-Za-z0-9_-]+$/.test(mapName)) {
+    Module['preRun'] = [function() {
+        Module['addRunDependency']('map');
+        fetch('/maps/' + mapName + '.pmap')
+            .then((r) => r.ok ? r.arrayBuffer() : Promise.reject(r.status))
+            .then((b) => Module['FS'].writeFile('/map.pmap', new Uint8Array(b)))
+            .catch((e) => console.log('Could not fetch map ' + mapName))
+            .finally(() => Module['removeRunDependency']('map'));
+    }];
+    Module['arguments'].push('--map=/map.pmap');
+}
 Module['print'] = function (text) {
 /*    const redirecttext = document.createElement("p");
     const scoretext = document.createElement("p");